@@ -0,0 +1,334 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <cstdint>
+#include <cmath>
+#include <new>
+#include <atomic>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include "../CodecTest/CodecApi.h"
+
+// Micro benchmarks for the C API. Uses only the C API and the standard library.
+//
+// mode=alloc  Counts heap allocations per encode call, for the streaming and the one-shot
+//             paths at several chunk sizes. Each path is run for calls/10 and for calls
+//             chunks on a fresh handle; an O(1) path allocates the same total for both
+//             runs, and equal per-call figures across chunk sizes show the count does not
+//             depend on the number of blocks. "allocator" counts what goes through
+//             Codec_SetAllocator, "new" counts global operator new (only allocations made
+//             in this module, so with the DLL build on Windows it sees the benchmark's own
+//             and none of the codec's). Neither sees malloc / calloc inside ldacBT.
+// mode=create Codec_Create / Codec_Destroy throughput from 1 up to threads= threads, each
+//             thread looping on its own handle for ms= milliseconds.
+// mode=pool   Handle open / close cycles for ms= milliseconds, Codec_Create + Codec_InitializeEx
+//             against Codec_Acquire (the instance pool), with and without one EncodeStream
+//             chunk per cycle (a used handle is what Codec_Destroy has to recycle).
+
+struct BenchConfig {
+    std::string mode = "alloc";
+    std::string codec = "ldac";
+    int sampleRate = 48000;
+    int channels = 2;
+    std::vector<int> chunkFrames{ 128, 480, 4800, 48000 };  // 480 is odd against the 128-frame LDAC block
+    int calls = 10000;        // at 480 frames; scaled down for longer chunks
+    int threads = 0;          // mode=create: 0 = hardware concurrency
+    double durationMs = 500;  // mode=create: per thread count; mode=pool: per row
+};
+
+// ---- allocation counters ----
+
+static std::atomic<uint64_t> g_newCount{ 0 };
+static std::atomic<uint64_t> g_allocatorCount{ 0 };
+
+void* operator new(size_t size) {
+    g_newCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+static void* CountingAlloc(size_t size, void*) {
+    g_allocatorCount.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size);
+}
+static void CountingFree(void* ptr, void*) { std::free(ptr); }
+
+struct AllocCount {
+    uint64_t allocator = 0;
+    uint64_t news = 0;
+};
+
+static AllocCount Snapshot() {
+    return { g_allocatorCount.load(std::memory_order_relaxed), g_newCount.load(std::memory_order_relaxed) };
+}
+
+// ---- mode=alloc ----
+
+enum class EncodePath { Stream, StreamArena, StreamInto, OneShot, OneShotArena, OneShotInto };
+
+static const char* PathName(EncodePath path) {
+    switch (path) {
+    case EncodePath::Stream:       return "EncodeStream";
+    case EncodePath::StreamArena:  return "EncodeStream+arena";
+    case EncodePath::StreamInto:   return "EncodeStreamInto";
+    case EncodePath::OneShot:      return "Encode";
+    case EncodePath::OneShotArena: return "Encode+arena";
+    default:                       return "EncodeInto";
+    }
+}
+
+// Encodes `calls` chunks through a fresh handle and returns the allocations made,
+// including the handle's own setup so one-off growth is part of the total.
+static bool CountCalls(const BenchConfig& cfg, EncodePath path, const std::vector<int16_t>& pcm, int calls, AllocCount& used) {
+    void* codec = Codec_Create(cfg.codec.c_str());
+    if (!codec) return false;
+    Codec_SetAllocator(codec, CountingAlloc, CountingFree, nullptr);
+    bool ok = Codec_Initialize(codec, cfg.sampleRate, cfg.channels, 16);
+    if (ok && (path == EncodePath::StreamArena || path == EncodePath::OneShotArena)) ok = Codec_SetArena(codec, true, 0);
+
+    const size_t inSize = pcm.size() * sizeof(int16_t);
+    std::vector<uint8_t> out(ok ? Codec_GetMaxEncodedSize(codec, inSize) : 0);
+
+    AllocCount before = Snapshot();
+    for (int i = 0; ok && i < calls; ++i) {
+        size_t outSize = 0;
+        switch (path) {
+        case EncodePath::StreamInto:
+            ok = Codec_EncodeStreamInto(codec, pcm.data(), inSize, out.data(), out.size(), &outSize);
+            break;
+        case EncodePath::OneShotInto:
+            ok = Codec_EncodeInto(codec, pcm.data(), inSize, out.data(), out.size(), &outSize);
+            break;
+        case EncodePath::Stream:
+        case EncodePath::StreamArena: {
+            uint8_t* encoded = Codec_EncodeStream(codec, pcm.data(), inSize, &outSize);
+            if (path == EncodePath::Stream) Codec_FreeBuffer(encoded);
+            break;
+        }
+        default: {
+            uint8_t* encoded = Codec_Encode(codec, pcm.data(), inSize, &outSize);
+            ok = encoded != nullptr;
+            if (path == EncodePath::OneShot) Codec_FreeBuffer(encoded);
+            break;
+        }
+        }
+    }
+    AllocCount after = Snapshot();
+    used.allocator = after.allocator - before.allocator;
+    used.news = after.news - before.news;
+
+    Codec_Destroy(codec);
+    return ok;
+}
+
+static int RunAllocBench(const BenchConfig& cfg) {
+    std::cout << "Allocations per encode call (" << cfg.codec << ", " << cfg.sampleRate << " Hz, " << cfg.channels << " ch)" << std::endl;
+    std::cout << "  Counted: Codec_SetAllocator and operator new. malloc / calloc inside ldacBT are not" << std::endl;
+    std::cout << "  counted (the one-shot paths re-initialize it per call), so 0 is not 0 heap allocations." << std::endl;
+    std::cout << "  chunk   path                  calls    allocator      new            per-call(steady)" << std::endl;
+
+    bool intoGrows = false;
+    for (int chunk : cfg.chunkFrames) {
+        std::vector<int16_t> pcm((size_t)chunk * cfg.channels);
+        for (size_t i = 0; i < pcm.size(); ++i)
+            pcm[i] = (int16_t)(8000.0 * std::sin((double)(i / cfg.channels) * 0.05 + (double)(i % cfg.channels)));
+
+        // Same amount of audio per chunk size, within reason
+        const int calls = std::max(20, (int)std::min<int64_t>(cfg.calls, (int64_t)cfg.calls * 480 / chunk));
+        const int shortCalls = std::max(1, calls / 10);
+        for (EncodePath path : { EncodePath::Stream, EncodePath::StreamArena, EncodePath::StreamInto,
+                                 EncodePath::OneShot, EncodePath::OneShotArena, EncodePath::OneShotInto }) {
+            AllocCount shortRun, longRun;
+            if (!CountCalls(cfg, path, pcm, shortCalls, shortRun) || !CountCalls(cfg, path, pcm, calls, longRun)) {
+                std::cerr << PathName(path) << " failed" << std::endl;
+                return 1;
+            }
+            // The extra calls of the long run are all steady state
+            const double perCall = (double)((longRun.allocator + longRun.news) - (shortRun.allocator + shortRun.news))
+                                 / (double)(calls - shortCalls);
+            std::string name = PathName(path);
+            std::cout << "  " << chunk << "\t  " << name << std::string(22 - name.size(), ' ')
+                      << shortCalls << "/" << calls << "\t   "
+                      << shortRun.allocator << "/" << longRun.allocator << "\t  "
+                      << shortRun.news << "/" << longRun.news << "\t " << perCall << std::endl;
+            if ((path == EncodePath::StreamInto || path == EncodePath::OneShotInto) && perCall > 0) intoGrows = true;
+        }
+    }
+
+    if (intoGrows) {
+        std::cerr << "Codec_EncodeStreamInto / Codec_EncodeInto allocate per call" << std::endl;
+        return 2;
+    }
+    return 0;
+}
+
+// ---- mode=create ----
+
+static int RunCreateBench(const BenchConfig& cfg) {
+    int maxThreads = cfg.threads > 0 ? cfg.threads : (int)std::max(1u, std::thread::hardware_concurrency());
+
+    // Fail early on an unknown codec name rather than timing the error path
+    void* probe = Codec_Create(cfg.codec.c_str());
+    if (!probe) {
+        std::cerr << "Unknown codec: " << cfg.codec << std::endl;
+        return 1;
+    }
+    Codec_Destroy(probe);
+
+    std::vector<int> steps;
+    for (int n = 1; n < maxThreads; n *= 2) steps.push_back(n);
+    steps.push_back(maxThreads);
+
+    std::cout << "Codec_Create / Codec_Destroy throughput (" << cfg.codec << ", " << cfg.durationMs << " ms per step)" << std::endl;
+    std::cout << "  threads  ops/s        per-thread   scaling" << std::endl;
+
+    double single = 0;
+    for (int n : steps) {
+        std::atomic<bool> start{ false }, stop{ false };
+        std::vector<uint64_t> ops(n, 0);
+        std::vector<std::thread> workers;
+        for (int t = 0; t < n; ++t) {
+            workers.emplace_back([&, t] {
+                while (!start.load(std::memory_order_acquire)) std::this_thread::yield();
+                uint64_t count = 0;
+                while (!stop.load(std::memory_order_relaxed)) {
+                    Codec_Destroy(Codec_Create(cfg.codec.c_str()));
+                    ++count;
+                }
+                ops[t] = count;
+            });
+        }
+
+        auto begin = std::chrono::steady_clock::now();
+        start.store(true, std::memory_order_release);
+        std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(cfg.durationMs));
+        stop.store(true, std::memory_order_relaxed);
+        for (auto& w : workers) w.join();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+        uint64_t total = 0;
+        for (uint64_t c : ops) total += c;
+        double rate = (double)total / seconds;
+        if (n == 1) single = rate;
+        std::cout << "  " << n << "\t   " << (uint64_t)rate << "\t" << (uint64_t)(rate / n) << "\t     "
+                  << (single > 0 ? rate / single : 0.0) << "x" << std::endl;
+    }
+    return 0;
+}
+
+// ---- mode=pool ----
+
+static int RunPoolBench(const BenchConfig& cfg) {
+    const Codec_AudioFormat format{ cfg.sampleRate, cfg.channels, CODEC_SAMPLE_S16, 1 };
+    const int chunk = cfg.chunkFrames.empty() ? 480 : cfg.chunkFrames.front();
+    std::vector<int16_t> pcm((size_t)chunk * cfg.channels);
+    for (size_t i = 0; i < pcm.size(); ++i)
+        pcm[i] = (int16_t)(8000.0 * std::sin((double)(i / cfg.channels) * 0.05 + (double)(i % cfg.channels)));
+    const size_t inSize = pcm.size() * sizeof(int16_t);
+
+    auto open = [&](bool pooled) -> void* {
+        if (pooled) return Codec_Acquire(cfg.codec.c_str(), &format, nullptr);
+        void* codec = Codec_Create(cfg.codec.c_str());
+        if (codec && !Codec_InitializeEx(codec, &format, nullptr)) {
+            Codec_Destroy(codec);
+            codec = nullptr;
+        }
+        return codec;
+    };
+
+    // Fail early rather than timing the error path
+    void* probe = open(false);
+    if (!probe) {
+        std::cerr << "Cannot open " << cfg.codec << " at " << cfg.sampleRate << " Hz, " << cfg.channels << " ch" << std::endl;
+        return 1;
+    }
+    Codec_Destroy(probe);
+
+    std::cout << "Open / close cycles (" << cfg.codec << ", " << cfg.sampleRate << " Hz, " << cfg.channels << " ch, "
+              << cfg.durationMs << " ms per row)" << std::endl;
+    std::cout << "  open                       work             cycles/s     us/cycle    pool hits/misses" << std::endl;
+
+    for (bool encode : { false, true }) {
+        for (bool pooled : { false, true }) {
+            Codec_ClearPool();
+            Codec_PoolStats before{};
+            Codec_GetPoolStats(&before);
+
+            uint64_t cycles = 0;
+            auto begin = std::chrono::steady_clock::now();
+            const auto until = begin + std::chrono::duration<double, std::milli>(cfg.durationMs);
+            while (std::chrono::steady_clock::now() < until) {
+                void* codec = open(pooled);
+                if (!codec) {
+                    std::cerr << (pooled ? "Codec_Acquire" : "Codec_Create") << " failed" << std::endl;
+                    return 1;
+                }
+                if (encode) {
+                    size_t outSize = 0;
+                    Codec_FreeBuffer(Codec_EncodeStream(codec, pcm.data(), inSize, &outSize));
+                }
+                Codec_Destroy(codec);
+                ++cycles;
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+            Codec_PoolStats after{};
+            Codec_GetPoolStats(&after);
+            std::string name = pooled ? "Codec_Acquire" : "Codec_Create+InitializeEx";
+            std::string work = encode ? "EncodeStream " + std::to_string(chunk) : "none";
+            std::cout << "  " << name << std::string(27 - name.size(), ' ') << work << std::string(17 - work.size(), ' ')
+                      << (uint64_t)((double)cycles / seconds) << "\t " << seconds * 1e6 / (double)cycles << "\t     "
+                      << (after.hits - before.hits) << "/" << (after.misses - before.misses) << std::endl;
+        }
+    }
+    Codec_ClearPool();
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    BenchConfig cfg;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        size_t eq = arg.find('=');
+        if (eq == std::string::npos) continue;
+        std::string key = arg.substr(0, eq);
+        std::string value = arg.substr(eq + 1);
+        if (key == "mode") cfg.mode = value;
+        else if (key == "codec") cfg.codec = value;
+        else if (key == "rate") cfg.sampleRate = std::stoi(value);
+        else if (key == "ch") cfg.channels = std::stoi(value);
+        else if (key == "chunk") {
+            // Comma separated list of sizes to sweep
+            cfg.chunkFrames.clear();
+            for (size_t pos = 0; pos < value.size();) {
+                size_t comma = value.find(',', pos);
+                if (comma == std::string::npos) comma = value.size();
+                if (comma > pos) cfg.chunkFrames.push_back(std::max(1, std::stoi(value.substr(pos, comma - pos))));
+                pos = comma + 1;
+            }
+        }
+        else if (key == "calls") cfg.calls = std::max(1, std::stoi(value));
+        else if (key == "threads") cfg.threads = std::max(0, std::stoi(value));
+        else if (key == "ms") cfg.durationMs = std::max(1.0, std::stod(value));
+    }
+
+    if (cfg.mode == "alloc") return RunAllocBench(cfg);
+    if (cfg.mode == "create") return RunCreateBench(cfg);
+    if (cfg.mode == "pool") return RunPoolBench(cfg);
+
+    std::cout << "Usage: " << argv[0] << " mode=alloc|create|pool [options]" << std::endl;
+    std::cout << "  mode=alloc          allocations per streaming and one-shot encode call" << std::endl;
+    std::cout << "                      (exit with 2 when an Into path allocates in steady state)" << std::endl;
+    std::cout << "  mode=create         Codec_Create / Codec_Destroy throughput from 1 to threads= threads" << std::endl;
+    std::cout << "  mode=pool           open / close cycles, Codec_Create + Codec_InitializeEx against Codec_Acquire" << std::endl;
+    std::cout << "                      (with one chunk= encode per cycle; the first size is used)" << std::endl;
+    std::cout << "  codec=<name> rate=<Hz> ch=<n> chunk=<frames>[,<frames>...] calls=<n>" << std::endl;
+    std::cout << "  threads=<n> ms=<per step>   (mode=create; threads=0 uses every core; ms= also for mode=pool)" << std::endl;
+    return 0;
+}
@@ -0,0 +1,229 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+#include "../CodecTest/CodecApi.h"
+
+// Regression checks for the C API. Uses only the C API and the standard library.
+// Runs every check (or only name=<check>) and exits with 1 when any of them fails.
+//
+// The parallel paths are checked against the serial ones byte for byte: splitting a call
+// across threads must not change its output.
+
+// ---- helpers ----
+
+static std::vector<int16_t> MakePcm(size_t frames, int channels) {
+    std::vector<int16_t> pcm(frames * channels);
+    for (size_t i = 0; i < pcm.size(); ++i) {
+        double t = (double)(i / channels);
+        pcm[i] = (int16_t)(6000.0 * std::sin(t * 0.031 * (1 + i % channels)) + 2000.0 * std::sin(t * 0.27));
+    }
+    return pcm;
+}
+
+static void* OpenLdac(int sampleRate, int channels) {
+    void* codec = Codec_Create("ldac");
+    if (codec && !Codec_Initialize(codec, sampleRate, channels, 16)) {
+        Codec_Destroy(codec);
+        codec = nullptr;
+    }
+    return codec;
+}
+
+// Takes over a buffer returned by the C API
+static std::vector<uint8_t> Take(uint8_t* buffer, size_t bytes) {
+    std::vector<uint8_t> out;
+    if (buffer) out.assign(buffer, buffer + bytes);
+    Codec_FreeBuffer(buffer);
+    return out;
+}
+
+static std::vector<uint8_t> Encode(void* codec, const std::vector<int16_t>& pcm) {
+    size_t bytes = 0;
+    uint8_t* buffer = Codec_Encode(codec, pcm.data(), pcm.size() * sizeof(int16_t), &bytes);
+    return Take(buffer, bytes);
+}
+
+static std::vector<uint8_t> Decode(void* codec, const uint8_t* data, size_t size) {
+    size_t bytes = 0;
+    uint8_t* buffer = Codec_Decode(codec, data, size, &bytes);
+    return Take(buffer, bytes);
+}
+
+// Byte offset of frame `frame` in an encoded stream
+static size_t FrameOffset(void* codec, const std::vector<uint8_t>& coded, size_t frame) {
+    size_t frames = 0;
+    uint64_t offset = 0;
+    if (!Codec_BuildFrameIndex(codec, coded.data(), coded.size(), &frames, nullptr) || frame >= frames) return coded.size();
+    Codec_GetFrameInfo(codec, frame, &offset, nullptr);
+    return (size_t)offset;
+}
+
+static bool Expect(bool condition, const std::string& what) {
+    if (!condition) std::cout << "    " << what << std::endl;
+    return condition;
+}
+
+// ---- checks ----
+
+// A stream decoded in two calls, serially and with parallel segments, including a damaged
+// frame in the second call so the parallel path has to fall back partway
+static bool CheckParallelDecode() {
+    bool ok = true;
+    for (int channels : { 2, 6 }) {
+        const std::string label = std::to_string(channels) + " ch: ";
+        void* encoder = OpenLdac(48000, channels);
+        if (!Expect(encoder != nullptr, label + "open failed")) return false;
+        std::vector<uint8_t> coded = Encode(encoder, MakePcm(128 * 2000, channels));
+        Codec_Destroy(encoder);
+
+        void* serial = OpenLdac(48000, channels);
+        void* parallel = OpenLdac(48000, channels);
+        Codec_SetParallelism(parallel, 4);
+
+        size_t split = FrameOffset(serial, coded, 900);
+        std::vector<uint8_t> damaged = coded;
+        size_t bad = FrameOffset(serial, coded, 1500) + 3;
+        for (size_t i = bad; i < bad + 4 && i < damaged.size(); ++i) damaged[i] = 0xEE;
+
+        for (const std::vector<uint8_t>* input : { &coded, &damaged }) {
+            const std::string what = label + (input == &coded ? "clean" : "damaged");
+            std::vector<uint8_t> a = Decode(serial, input->data(), split);
+            std::vector<uint8_t> b = Decode(serial, input->data() + split, input->size() - split);
+            std::vector<uint8_t> c = Decode(parallel, input->data(), split);
+            std::vector<uint8_t> d = Decode(parallel, input->data() + split, input->size() - split);
+            ok = Expect(!a.empty() && !b.empty(), what + ": nothing decoded") && ok;
+            ok = Expect(a == c, what + ": first call differs from serial") && ok;
+            ok = Expect(b == d, what + ": continued call differs from serial") && ok;
+        }
+        Codec_Destroy(serial);
+        Codec_Destroy(parallel);
+    }
+    return ok;
+}
+
+// A one-shot Encode on a handle with a stream in progress continues that stream, so the
+// parallel path has to step aside for it; afterwards (a fresh stream) it may split again
+static bool CheckParallelEncodeAfterStream() {
+    bool ok = true;
+    for (int sampleRate : { 48000, 96000 }) {
+        const std::string label = std::to_string(sampleRate) + " Hz: ";
+        void* serial = OpenLdac(sampleRate, 2);
+        void* parallel = OpenLdac(sampleRate, 2);
+        if (!Expect(serial && parallel, label + "open failed")) {
+            Codec_Destroy(serial);
+            Codec_Destroy(parallel);
+            return false;
+        }
+        Codec_SetParallelism(parallel, 4);
+
+        // Whole blocks only, so nothing is left pending and only the stream state carries over
+        const std::vector<int16_t> head = MakePcm(128 * 16, 2);
+        const std::vector<int16_t> body = MakePcm(128 * 2000, 2);
+        for (void* codec : { serial, parallel }) {
+            size_t bytes = 0;
+            Codec_FreeBuffer(Codec_EncodeStream(codec, head.data(), head.size() * sizeof(int16_t), &bytes));
+        }
+        std::vector<uint8_t> a = Encode(serial, body);
+        std::vector<uint8_t> b = Encode(parallel, body);
+        ok = Expect(!a.empty(), label + "nothing encoded") && ok;
+        ok = Expect(a == b, label + "Encode after EncodeStream differs from serial") && ok;
+
+        std::vector<uint8_t> c = Encode(serial, body);
+        std::vector<uint8_t> d = Encode(parallel, body);
+        ok = Expect(c == d, label + "Encode on a fresh stream differs from serial") && ok;
+
+        Codec_Destroy(serial);
+        Codec_Destroy(parallel);
+    }
+    return ok;
+}
+
+// Codec_Destroy from inside the completion callback must not wait on the job that is
+// calling it; the handle goes away once its remaining jobs have run
+struct DestroyInNotify {
+    void* codec = nullptr;
+    std::atomic<bool> armed{ false };  // both jobs are queued
+    std::atomic<bool> destroyed{ false };
+};
+
+static void DestroyOnNotify(void* user) {
+    DestroyInNotify* state = static_cast<DestroyInNotify*>(user);
+    while (!state->armed) std::this_thread::yield();
+    if (void* codec = state->codec) {
+        state->codec = nullptr;
+        Codec_Destroy(codec);
+        state->destroyed = true;
+    }
+}
+
+static bool CheckDestroyInNotify() {
+    DestroyInNotify state;
+    state.codec = OpenLdac(48000, 2);
+    if (!Expect(state.codec != nullptr, "open failed")) return false;
+    void* queue = Codec_CreateCompletionQueue(DestroyOnNotify, &state);
+    const std::vector<int16_t> pcm = MakePcm(128 * 40, 2);
+    // The second job is still queued when the first one's callback destroys the handle
+    bool ok = Expect(Codec_Submit(queue, state.codec, CODEC_OP_ENCODE, pcm.data(), pcm.size() * sizeof(int16_t), nullptr) != 0, "submit failed");
+    ok = Expect(Codec_Submit(queue, state.codec, CODEC_OP_ENCODE, pcm.data(), pcm.size() * sizeof(int16_t), nullptr) != 0, "submit failed") && ok;
+    state.armed = true;
+
+    auto until = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!state.destroyed && std::chrono::steady_clock::now() < until) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    if (!state.destroyed) {
+        // The worker is stuck inside Codec_Destroy and would hang the exit as well
+        std::cout << "    Codec_Destroy in the completion callback deadlocked" << std::endl;
+        std::cout << "FAIL destroy-in-notify" << std::endl;
+        std::_Exit(1);
+    }
+
+    Codec_Completion done[2];
+    size_t count = 0;
+    while (count < 2) {
+        size_t got = Codec_PollCompletions(queue, done + count, 2 - count, 1000);
+        if (got == 0) break;
+        count += got;
+    }
+    ok = Expect(count == 2, "both jobs complete") && ok;
+    for (size_t i = 0; i < count; ++i) {
+        ok = Expect(done[i].result != 0, "job failed") && ok;
+        Codec_FreeBuffer(done[i].output);
+    }
+    Codec_DestroyCompletionQueue(queue);
+    return ok;
+}
+
+struct Check {
+    const char* name;
+    bool (*run)();
+};
+
+static const Check kChecks[] = {
+    { "parallel-decode", CheckParallelDecode },
+    { "parallel-encode-after-stream", CheckParallelEncodeAfterStream },
+    { "destroy-in-notify", CheckDestroyInNotify },
+};
+
+int main(int argc, char* argv[])
+{
+    std::string only;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("name=", 0) == 0) only = arg.substr(5);
+    }
+
+    int failed = 0;
+    for (const Check& check : kChecks) {
+        if (!only.empty() && only != check.name) continue;
+        bool passed = check.run();
+        std::cout << (passed ? "PASS " : "FAIL ") << check.name << std::endl;
+        if (!passed) failed++;
+    }
+    return failed > 0 ? 1 : 0;
+}
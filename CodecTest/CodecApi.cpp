@@ -2,11 +2,272 @@
 #include "CodecApi.h"
 #include "include/IAudioCodec.h"
 #include "src/AudioCodecFactory.h"
+#include "src/CodecAllocator.h"
+#include "src/WorkerPool.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdlib>
 #include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <span>
+#include <thread>
 
 using namespace CodecTest;
 
+namespace
+{
+    // C API のハンドル実体：コーデック本体と、ハンドル単位のアロケータ・アリーナ
+    struct CodecHandle
+    {
+        std::unique_ptr<IAudioCodec> codec;
+        CodecAllocator allocator;
+        bool hasAllocator{ false };
+        BumpArena arena;
+        bool useArena{ false };
+        FrameIndex frameIndex;  // Codec_BuildFrameIndex の結果
+        // Codec_Acquire で取得したもの。Codec_Destroy でプールへ返却する
+        bool pooled{ false };
+        CodecPoolKey poolKey;
+        // Codec_Submit で投入された処理。投入順に 1 つずつ共有プールで実行する
+        std::mutex asyncMtx;
+        std::condition_variable asyncIdle;
+        std::deque<std::function<void()>> asyncJobs;
+        bool asyncRunning{ false };
+        std::thread::id asyncThread;  // 積まれた処理を実行中のスレッド
+        bool destroyPending{ false };  // 処理中（完了通知の中など）に Codec_Destroy された
+    };
+
+    // 非同期処理の完了キュー
+    struct CompletionQueue
+    {
+        Codec_CompletionNotify notify{ nullptr };
+        void* user{ nullptr };
+        std::mutex mtx;
+        std::condition_variable ready;
+        std::deque<Codec_Completion> done;
+        size_t outstanding{ 0 };  // 投入済みで未完了の数
+    };
+
+    std::atomic<uint64_t> g_nextAsyncId{ 1 };
+
+    // ライブラリ全体の既定アロケータ（Codec_SetAllocator(nullptr, ...) で設定）
+    CodecAllocator g_allocator;
+
+    // 返却バッファの先頭に置くヘッダ。Codec_FreeBuffer がどこへ返すかを判断する。
+    struct alignas(std::max_align_t) BufferHeader
+    {
+        CodecAllocator owner;
+        bool fromArena;
+    };
+
+    CodecHandle* ToHandle(void* codec)
+    {
+        return static_cast<CodecHandle*>(codec);
+    }
+
+    // C API の設定を変換する。範囲外の値は false
+    bool ToAudioFormat(const Codec_AudioFormat& format, AudioFormat& f)
+    {
+        if (format.sampleFormat < CODEC_SAMPLE_S16 || format.sampleFormat > CODEC_SAMPLE_F32) return false;
+        f.sampleRate = format.sampleRate;
+        f.channels = format.channels;
+        f.sampleFormat = static_cast<SampleFormat>(format.sampleFormat);
+        f.interleaved = format.interleaved != 0;
+        return true;
+    }
+
+    void ToCodecCapabilities(const CodecCapabilities& caps, Codec_Capabilities* out)
+    {
+        *out = {};
+        for (int rate : caps.sampleRates) {
+            if (out->sampleRateCount == CODEC_MAX_SAMPLE_RATES) break;
+            out->sampleRates[out->sampleRateCount++] = rate;
+        }
+        for (SampleFormat format : caps.sampleFormats) out->sampleFormats |= 1u << static_cast<int>(format);
+        out->maxChannels = caps.maxChannels;
+        out->frameSamples = caps.frameSamples;
+        out->blockSamples = caps.blockSamples;
+        out->delaySamples = caps.delaySamples;
+        out->maxFrameBytes = caps.maxFrameBytes;
+        out->maxBitrate = caps.maxBitrate;
+        out->mtu = caps.mtu;
+    }
+
+    bool ToEncoderOptions(const Codec_EncoderOptions* options, EncoderOptions& o)
+    {
+        if (!options) return true;
+        if (options->quality < CODEC_QUALITY_HIGH || options->quality > CODEC_QUALITY_MOBILE || options->mtu < 0) return false;
+        o.quality = static_cast<EncodeQuality>(options->quality);
+        o.mtu = options->mtu;
+        o.adaptive = options->adaptive != 0;
+        return true;
+    }
+
+    const CodecAllocator& AllocatorOf(const CodecHandle* h)
+    {
+        return h->hasAllocator ? h->allocator : g_allocator;
+    }
+
+    // 出力バッファを確保する（ヘッダ分を含む）。アリーナ有効時はアリーナから切り出す。
+    uint8_t* AllocateOutput(CodecHandle* h, size_t size)
+    {
+        size_t total = sizeof(BufferHeader) + size;
+        void* block = h->useArena ? h->arena.Allocate(total) : AllocatorOf(h).Allocate(total);
+        if (!block) return nullptr;
+        BufferHeader* header = new (block) BufferHeader{ AllocatorOf(h), h->useArena };
+        return reinterpret_cast<uint8_t*>(header + 1);
+    }
+
+    // 書き込み後に余った末尾を返す。malloc 系なら realloc、アリーナなら次の確保に回す。
+    uint8_t* ShrinkOutput(CodecHandle* h, uint8_t* buf, size_t capacity, size_t written)
+    {
+        BufferHeader* header = reinterpret_cast<BufferHeader*>(buf) - 1;
+        if (header->fromArena)
+        {
+            h->arena.Shrink(header, sizeof(BufferHeader) + capacity, sizeof(BufferHeader) + written);
+            return buf;
+        }
+        if (header->owner.IsDefault())
+        {
+            // 縮小は失敗しても元のバッファがそのまま使える
+            if (void* shrunk = std::realloc(header, sizeof(BufferHeader) + written))
+                return reinterpret_cast<uint8_t*>(static_cast<BufferHeader*>(shrunk) + 1);
+        }
+        return buf;
+    }
+
+    void FreeOutput(uint8_t* buf)
+    {
+        BufferHeader* header = reinterpret_cast<BufferHeader*>(buf) - 1;
+        if (header->fromArena) return; // 次の呼び出しでアリーナごと再利用される
+        CodecAllocator owner = header->owner;
+        header->~BufferHeader();
+        owner.Free(header);
+    }
+
+    // 最悪サイズで確保した返却バッファへ直接書き込み、余りを切り詰めて返す（中間 vector を経由しない）
+    template <typename IntoFn>
+    uint8_t* IntoOutputBuffer(CodecHandle* h, size_t capacity, size_t* outSize, IntoFn&& into)
+    {
+        *outSize = 0;
+        if (capacity == 0) return nullptr;
+        uint8_t* buf = AllocateOutput(h, capacity);
+        if (!buf) return nullptr;
+
+        size_t written = 0;
+        into(std::span<uint8_t>(buf, capacity), written);
+        if (written == 0)
+        {
+            FreeOutput(buf);
+            return nullptr;
+        }
+        *outSize = written;
+        return ShrinkOutput(h, buf, capacity, written);
+    }
+
+    // *Into 系の共通処理：容量不足なら必要サイズを返して何もしない
+    template <typename IntoFn>
+    bool IntoCallerBuffer(size_t required, uint8_t* output, size_t outCapacity, size_t* outSize, IntoFn&& into)
+    {
+        if (!output || outCapacity < required)
+        {
+            *outSize = required;
+            return false;
+        }
+        size_t written = 0;
+        bool ok = into(std::span<uint8_t>(output, outCapacity), written);
+        *outSize = written;
+        return ok;
+    }
+
+    // 返却バッファを伴う呼び出しの開始時にアリーナを巻き戻す
+    void BeginCall(CodecHandle* h)
+    {
+        if (h->useArena) h->arena.Reset();
+    }
+
+    // 非同期処理 1 件分。同期版と同じく返却バッファへ直接書き込む
+    bool RunAsyncOp(CodecHandle* h, int op, const void* input, size_t inSize, uint8_t*& output, size_t& outSize)
+    {
+        IAudioCodec* c = h->codec.get();
+        bool ok = false;
+        auto run = [&](size_t capacity, auto&& into) {
+            output = IntoOutputBuffer(h, capacity, &outSize, [&](std::span<uint8_t> out, size_t& written) {
+                ok = into(out, written);
+                return ok;
+            });
+        };
+        switch (op) {
+        case CODEC_OP_ENCODE:
+            run(c->MaxEncodedBytes(inSize), [&](std::span<uint8_t> out, size_t& written) { return c->EncodeInto(input, inSize, out, written); });
+            break;
+        case CODEC_OP_ENCODE_STREAM:
+            run(c->MaxEncodedBytes(inSize), [&](std::span<uint8_t> out, size_t& written) { return c->EncodeStreamInto(input, inSize, out, written); });
+            break;
+        case CODEC_OP_FLUSH_STREAM:
+            run(c->MaxEncodedBytes(0), [&](std::span<uint8_t> out, size_t& written) { return c->FlushStreamInto(out, written); });
+            break;
+        case CODEC_OP_DECODE:
+            run(c->DecodedBytes(input, inSize), [&](std::span<uint8_t> out, size_t& written) { return c->DecodeInto(input, inSize, out, written); });
+            break;
+        }
+        return ok;
+    }
+
+    // ハンドルを破棄する（Codec_Acquire で取得したものはプールへ返却する）
+    void DestroyHandle(CodecHandle* h)
+    {
+        if (h->pooled) AudioCodecFactory::Instance().Release(h->poolKey, std::move(h->codec));
+        delete h;
+    }
+
+    // ハンドルに積まれた処理を空になるまで順に実行する（共有プールのタスク）
+    void RunAsyncJobs(CodecHandle* h)
+    {
+        for (;;) {
+            std::function<void()> job;
+            {
+                std::lock_guard<std::mutex> lk(h->asyncMtx);
+                if (h->asyncJobs.empty()) {
+                    // 処理中に Codec_Destroy されていれば、ここで代わりに破棄する
+                    if (h->destroyPending) break;
+                    // ロック下で通知する（Codec_Destroy はこの後ハンドルを解放する）
+                    h->asyncRunning = false;
+                    h->asyncIdle.notify_all();
+                    return;
+                }
+                job = std::move(h->asyncJobs.front());
+                h->asyncJobs.pop_front();
+                h->asyncThread = std::this_thread::get_id();
+            }
+            job();
+        }
+        DestroyHandle(h);
+    }
+
+    void PostCompletion(CompletionQueue* q, const Codec_Completion& completion)
+    {
+        Codec_CompletionNotify notify;
+        void* user;
+        {
+            std::lock_guard<std::mutex> lk(q->mtx);
+            q->done.push_back(completion);
+            q->outstanding--;
+            notify = q->notify;
+            user = q->user;
+            q->ready.notify_all();
+        }
+        // ロックの外で呼ぶ（通知先から Codec_PollCompletions を呼べるように）
+        if (notify) notify(user);
+    }
+}
+
 extern "C"
 {
 
@@ -15,70 +276,177 @@ void* Codec_Create(const char* name)
     if (!name) return nullptr;
     auto codec = AudioCodecFactory::Instance().Create(name);
     if (!codec) return nullptr;
+    auto handle = std::make_unique<CodecHandle>();
+    handle->codec = std::move(codec);
     // unique_ptr の管理から外して呼び出し元（void*）に委譲する
-    return codec.release();
+    return handle.release();
 }
 
 void Codec_Destroy(void* codec)
 {
     if (!codec) return;
-    IAudioCodec* c = static_cast<IAudioCodec*>(codec);
-    delete c;
+    CodecHandle* h = ToHandle(codec);
+    {
+        std::unique_lock<std::mutex> lk(h->asyncMtx);
+        // 完了通知（Codec_CompletionNotify）の中など、このハンドルの処理を実行中のスレッドから
+        // 呼ばれた場合は待つと自分自身を待つことになる。残りの処理を終えた RunAsyncJobs が破棄する
+        if (h->asyncRunning && h->asyncThread == std::this_thread::get_id()) {
+            h->destroyPending = true;
+            return;
+        }
+        // 実行中の非同期処理が終わるのを待つ
+        h->asyncIdle.wait(lk, [h]() { return !h->asyncRunning; });
+    }
+    DestroyHandle(h);
 }
 
 bool Codec_Initialize(void* codec, int sampleRate, int channels, int bitsPerSample)
 {
     if (!codec) return false;
-    IAudioCodec* c = static_cast<IAudioCodec*>(codec);
-    return c->Initialize(sampleRate, channels, bitsPerSample);
+    CodecHandle* h = ToHandle(codec);
+    h->pooled = false;
+    return h->codec->Initialize(sampleRate, channels, bitsPerSample);
+}
+
+bool Codec_InitializeFormat(void* codec, int sampleRate, int channels, int sampleFormat)
+{
+    if (!codec) return false;
+    if (sampleFormat < CODEC_SAMPLE_S16 || sampleFormat > CODEC_SAMPLE_F32) return false;
+    CodecHandle* h = ToHandle(codec);
+    h->pooled = false;
+    return h->codec->Initialize(sampleRate, channels, static_cast<SampleFormat>(sampleFormat));
+}
+
+bool Codec_InitializeEx(void* codec, const Codec_AudioFormat* format, const Codec_EncoderOptions* options)
+{
+    if (!codec || !format) return false;
+    AudioFormat f;
+    EncoderOptions o;
+    if (!ToAudioFormat(*format, f) || !ToEncoderOptions(options, o)) return false;
+    CodecHandle* h = ToHandle(codec);
+    h->pooled = false;
+    return h->codec->Initialize(f, o);
+}
+
+bool Codec_ReportLinkBudget(void* codec, int kbps)
+{
+    if (!codec || kbps <= 0) return false;
+    ToHandle(codec)->codec->ReportLinkBudget(kbps);
+    return true;
+}
+
+int Codec_GetBitrate(void* codec)
+{
+    if (!codec) return 0;
+    return ToHandle(codec)->codec->GetBitrate();
+}
+
+bool Codec_GetCapabilities(void* codec, Codec_Capabilities* caps)
+{
+    if (!codec || !caps) return false;
+    ToCodecCapabilities(ToHandle(codec)->codec->GetCapabilities(), caps);
+    return true;
+}
+
+bool Codec_QueryCapabilities(const char* name, Codec_Capabilities* caps)
+{
+    if (!name || !caps) return false;
+    CodecCapabilities c;
+    if (!AudioCodecFactory::Instance().GetCapabilities(name, c)) return false;
+    ToCodecCapabilities(c, caps);
+    return true;
 }
 
 uint8_t* Codec_Encode(void* codec, const void* input, size_t inSize, size_t* outSize)
 {
     if (!codec || !input || !outSize) return nullptr;
-    IAudioCodec* c = static_cast<IAudioCodec*>(codec);
-    auto outVec = c->Encode(input, inSize);
-    if (outVec.empty())
-    {
-        *outSize = 0;
-        return nullptr;
-    }
-    *outSize = outVec.size();
-    uint8_t* buf = static_cast<uint8_t*>(std::malloc(*outSize));
-    if (!buf)
-    {
-        *outSize = 0;
-        return nullptr;
-    }
-    std::memcpy(buf, outVec.data(), *outSize);
-    return buf;
+    CodecHandle* h = ToHandle(codec);
+    IAudioCodec* c = h->codec.get();
+    BeginCall(h);
+    return IntoOutputBuffer(h, c->MaxEncodedBytes(inSize), outSize, [&](std::span<uint8_t> out, size_t& written) {
+        return c->EncodeInto(input, inSize, out, written);
+    });
+}
+
+uint8_t* Codec_EncodeStream(void* codec, const void* input, size_t inSize, size_t* outSize)
+{
+    if (!codec || !input || !outSize) return nullptr;
+    CodecHandle* h = ToHandle(codec);
+    IAudioCodec* c = h->codec.get();
+    BeginCall(h);
+    return IntoOutputBuffer(h, c->MaxEncodedBytes(inSize), outSize, [&](std::span<uint8_t> out, size_t& written) {
+        return c->EncodeStreamInto(input, inSize, out, written);
+    });
+}
+
+uint8_t* Codec_FlushStream(void* codec, size_t* outSize)
+{
+    if (!codec || !outSize) return nullptr;
+    CodecHandle* h = ToHandle(codec);
+    IAudioCodec* c = h->codec.get();
+    BeginCall(h);
+    return IntoOutputBuffer(h, c->MaxEncodedBytes(0), outSize, [&](std::span<uint8_t> out, size_t& written) {
+        return c->FlushStreamInto(out, written);
+    });
 }
 
 uint8_t* Codec_Decode(void* codec, const void* input, size_t inSize, size_t* outSize)
 {
     if (!codec || !input || !outSize) return nullptr;
-    IAudioCodec* c = static_cast<IAudioCodec*>(codec);
-    auto outVec = c->Decode(input, inSize);
-    if (outVec.empty())
-    {
-        *outSize = 0;
-        return nullptr;
-    }
-    *outSize = outVec.size();
-    uint8_t* buf = static_cast<uint8_t*>(std::malloc(*outSize));
-    if (!buf)
-    {
-        *outSize = 0;
-        return nullptr;
-    }
-    std::memcpy(buf, outVec.data(), *outSize);
-    return buf;
+    CodecHandle* h = ToHandle(codec);
+    IAudioCodec* c = h->codec.get();
+    BeginCall(h);
+    // ヘッダ走査で正確な出力サイズを求め、返却バッファへ直接デコードする
+    return IntoOutputBuffer(h, c->DecodedBytes(input, inSize), outSize, [&](std::span<uint8_t> out, size_t& written) {
+        return c->DecodeInto(input, inSize, out, written);
+    });
+}
+
+size_t Codec_GetDecodedSize(void* codec, const void* input, size_t inSize)
+{
+    if (!codec || !input) return 0;
+    return ToHandle(codec)->codec->DecodedBytes(input, inSize);
+}
+
+bool Codec_BuildFrameIndex(void* codec, const void* input, size_t inSize, size_t* frameCount, uint64_t* totalSamples)
+{
+    if (!codec || !input) return false;
+    CodecHandle* h = ToHandle(codec);
+    bool ok = h->codec->BuildFrameIndex(input, inSize, h->frameIndex);
+    if (frameCount) *frameCount = h->frameIndex.frames.size();
+    if (totalSamples) *totalSamples = h->frameIndex.totalSamples;
+    return ok;
+}
+
+bool Codec_GetFrameInfo(void* codec, size_t frame, uint64_t* offset, uint64_t* samplePosition)
+{
+    if (!codec) return false;
+    const FrameIndex& index = ToHandle(codec)->frameIndex;
+    if (frame >= index.frames.size()) return false;
+    if (offset) *offset = index.frames[frame].offset;
+    if (samplePosition) *samplePosition = index.frames[frame].samplePosition;
+    return true;
+}
+
+uint8_t* Codec_DecodeRange(void* codec, const void* input, size_t inSize, size_t firstFrame, size_t frameCount, size_t* outSize)
+{
+    if (!codec || !input || !outSize) return nullptr;
+    CodecHandle* h = ToHandle(codec);
+    BeginCall(h);
+    IAudioCodec* c = h->codec.get();
+    const FrameIndex& index = h->frameIndex;
+    // 索引から範囲の出力サイズがそのまま分かるので、返却バッファへ直接デコードする
+    size_t lastFrame = firstFrame < index.frames.size() ? std::min(index.frames.size(), firstFrame + frameCount) : firstFrame;
+    size_t capacity = (size_t)index.PcmBytes(firstFrame, lastFrame, SampleFormatBytes(c->GetAudioFormat().sampleFormat));
+    return IntoOutputBuffer(h, capacity, outSize, [&](std::span<uint8_t> out, size_t& written) {
+        return c->DecodeRangeInto(input, inSize, index, firstFrame, frameCount, out, written);
+    });
 }
 
 bool Codec_GetLastFormat(void* codec, int* sampleRate, int* channels, int* bitsPerSample)
 {
     if (!codec) return false;
-    IAudioCodec* c = static_cast<IAudioCodec*>(codec);
+    IAudioCodec* c = ToHandle(codec)->codec.get();
     int r = 0, ch = 0, b = 0;
     c->GetFormat(r, ch, b);
     if (sampleRate) *sampleRate = r;
@@ -87,9 +455,307 @@ bool Codec_GetLastFormat(void* codec, int* sampleRate, int* channels, int* bitsP
     return true;
 }
 
+int Codec_GetSampleFormat(void* codec)
+{
+    if (!codec) return -1;
+    return static_cast<int>(ToHandle(codec)->codec->GetSampleFormat());
+}
+
+bool Codec_GetAudioFormat(void* codec, Codec_AudioFormat* format)
+{
+    if (!codec || !format) return false;
+    AudioFormat f = ToHandle(codec)->codec->GetAudioFormat();
+    format->sampleRate = f.sampleRate;
+    format->channels = f.channels;
+    format->sampleFormat = static_cast<int>(f.sampleFormat);
+    format->interleaved = f.interleaved ? 1 : 0;
+    return true;
+}
+
+bool Codec_GetDecodeStats(void* codec, uint64_t* bytesSkipped, uint64_t* resyncs, uint64_t* framesDecoded)
+{
+    if (!codec) return false;
+    DecodeStats stats = ToHandle(codec)->codec->GetDecodeStats();
+    if (bytesSkipped) *bytesSkipped = stats.bytesSkipped;
+    if (resyncs) *resyncs = stats.resyncs;
+    if (framesDecoded) *framesDecoded = stats.framesDecoded;
+    return true;
+}
+
+bool Codec_SetParallelism(void* codec, int threads)
+{
+    if (!codec || threads < 0) return false;
+    ToHandle(codec)->codec->SetParallelism(threads);
+    return true;
+}
+
+bool Codec_EncodeInto(void* codec, const void* input, size_t inSize, uint8_t* output, size_t outCapacity, size_t* outSize)
+{
+    if (!codec || !input || !outSize) return false;
+    IAudioCodec* c = ToHandle(codec)->codec.get();
+    return IntoCallerBuffer(c->MaxEncodedBytes(inSize), output, outCapacity, outSize, [&](std::span<uint8_t> out, size_t& written) {
+        return c->EncodeInto(input, inSize, out, written);
+    });
+}
+
+bool Codec_EncodeStreamInto(void* codec, const void* input, size_t inSize, uint8_t* output, size_t outCapacity, size_t* outSize)
+{
+    if (!codec || !input || !outSize) return false;
+    IAudioCodec* c = ToHandle(codec)->codec.get();
+    return IntoCallerBuffer(c->MaxEncodedBytes(inSize), output, outCapacity, outSize, [&](std::span<uint8_t> out, size_t& written) {
+        return c->EncodeStreamInto(input, inSize, out, written);
+    });
+}
+
+bool Codec_FlushStreamInto(void* codec, uint8_t* output, size_t outCapacity, size_t* outSize)
+{
+    if (!codec || !outSize) return false;
+    IAudioCodec* c = ToHandle(codec)->codec.get();
+    return IntoCallerBuffer(c->MaxEncodedBytes(0), output, outCapacity, outSize, [&](std::span<uint8_t> out, size_t& written) {
+        return c->FlushStreamInto(out, written);
+    });
+}
+
+bool Codec_DecodeInto(void* codec, const void* input, size_t inSize, uint8_t* output, size_t outCapacity, size_t* outSize)
+{
+    if (!codec || !input || !outSize) return false;
+    IAudioCodec* c = ToHandle(codec)->codec.get();
+    return IntoCallerBuffer(c->DecodedBytes(input, inSize), output, outCapacity, outSize, [&](std::span<uint8_t> out, size_t& written) {
+        return c->DecodeInto(input, inSize, out, written);
+    });
+}
+
+size_t Codec_GetMaxEncodedSize(void* codec, size_t inSize)
+{
+    if (!codec) return 0;
+    IAudioCodec* c = ToHandle(codec)->codec.get();
+    return c->MaxEncodedBytes(inSize);
+}
+
+size_t Codec_GetMaxDecodedSize(void* codec, size_t inSize)
+{
+    if (!codec) return 0;
+    IAudioCodec* c = ToHandle(codec)->codec.get();
+    return c->MaxDecodedBytes(inSize);
+}
+
+bool Codec_SetAllocator(void* codec, Codec_AllocFunc allocFunc, Codec_FreeFunc freeFunc, void* user)
+{
+    // 片方だけの指定は受け付けない（両方 nullptr で既定に戻す）
+    if ((allocFunc == nullptr) != (freeFunc == nullptr)) return false;
+    CodecAllocator allocator{ allocFunc, freeFunc, user };
+
+    if (!codec)
+    {
+        g_allocator = allocator;
+        return true;
+    }
+    CodecHandle* h = ToHandle(codec);
+    h->allocator = allocator;
+    h->hasAllocator = !allocator.IsDefault();
+    h->arena.SetAllocator(AllocatorOf(h));
+    return true;
+}
+
+bool Codec_SetArena(void* codec, bool enable, size_t initialBytes)
+{
+    if (!codec) return false;
+    CodecHandle* h = ToHandle(codec);
+    // アロケータが変わらなければアリーナはそのまま（容量の変更のみ）
+    h->arena.SetAllocator(AllocatorOf(h));
+    h->useArena = enable;
+    if (!enable) return true;
+    return h->arena.Reserve(initialBytes);
+}
+
+bool Codec_GetArenaStats(void* codec, size_t* capacity, size_t* highWater)
+{
+    if (!codec) return false;
+    CodecHandle* h = ToHandle(codec);
+    if (capacity) *capacity = h->arena.Capacity();
+    if (highWater) *highWater = h->arena.HighWater();
+    return h->useArena;
+}
+
 void Codec_FreeBuffer(uint8_t* buffer)
 {
-    if (buffer) std::free(buffer);
+    if (buffer) FreeOutput(buffer);
+}
+
+void* Codec_Acquire(const char* name, const Codec_AudioFormat* format, const Codec_EncoderOptions* options)
+{
+    if (!name || !format) return nullptr;
+    CodecPoolKey key;
+    key.name = name;
+    if (!ToAudioFormat(*format, key.format) || !ToEncoderOptions(options, key.options)) return nullptr;
+
+    auto codec = AudioCodecFactory::Instance().Acquire(key);
+    if (!codec) return nullptr;
+    auto handle = std::make_unique<CodecHandle>();
+    handle->codec = std::move(codec);
+    handle->pooled = true;
+    handle->poolKey = std::move(key);
+    return handle.release();
+}
+
+void Codec_SetPoolLimits(size_t perKey, size_t total)
+{
+    AudioCodecFactory::Instance().SetPoolLimits(perKey, total);
+}
+
+bool Codec_GetPoolStats(Codec_PoolStats* stats)
+{
+    if (!stats) return false;
+    CodecPoolStats s = AudioCodecFactory::Instance().GetPoolStats();
+    stats->hits = s.hits;
+    stats->misses = s.misses;
+    stats->recycled = s.recycled;
+    stats->discarded = s.discarded;
+    stats->idle = s.idle;
+    return true;
+}
+
+void Codec_ClearPool(void)
+{
+    AudioCodecFactory::Instance().ClearPool();
+}
+
+bool Codec_EncodeBatch(Codec_EncodeJob* jobs, size_t count)
+{
+    if (!jobs || count == 0) return false;
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point submitted = Clock::now();
+
+    auto runJob = [submitted](Codec_EncodeJob& job) {
+        const Clock::time_point start = Clock::now();
+        job.queueNs = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(start - submitted).count();
+        job.outSize = 0;
+        bool ok = false;
+        if (job.codec && job.input) {
+            ok = job.stream
+                ? Codec_EncodeStreamInto(job.codec, job.input, job.inSize, job.output, job.outCapacity, &job.outSize)
+                : Codec_EncodeInto(job.codec, job.input, job.inSize, job.output, job.outCapacity, &job.outSize);
+        }
+        job.result = ok ? 1 : 0;
+        job.runNs = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+    };
+
+    // 最後の 1 件は呼び出し元スレッドで実行する
+    TaskGroup group(WorkerPool::Shared());
+    for (size_t i = 0; i + 1 < count; ++i) group.Run([&runJob, job = &jobs[i]]() { runJob(*job); });
+    runJob(jobs[count - 1]);
+    group.Wait();
+
+    bool ok = true;
+    for (size_t i = 0; i < count; ++i) ok = ok && jobs[i].result != 0;
+    return ok;
+}
+
+void* Codec_CreateCompletionQueue(Codec_CompletionNotify notify, void* user)
+{
+    auto q = std::make_unique<CompletionQueue>();
+    q->notify = notify;
+    q->user = user;
+    return q.release();
+}
+
+void Codec_DestroyCompletionQueue(void* queue)
+{
+    if (!queue) return;
+    CompletionQueue* q = static_cast<CompletionQueue*>(queue);
+    {
+        std::unique_lock<std::mutex> lk(q->mtx);
+        q->ready.wait(lk, [q]() { return q->outstanding == 0; });
+    }
+    for (Codec_Completion& c : q->done) {
+        if (c.output) Codec_FreeBuffer(c.output);
+    }
+    delete q;
+}
+
+uint64_t Codec_Submit(void* queue, void* codec, int op, const void* input, size_t inSize, void* user)
+{
+    if (!queue || !codec) return 0;
+    if (op < CODEC_OP_ENCODE || op > CODEC_OP_DECODE) return 0;
+    if (op != CODEC_OP_FLUSH_STREAM && !input) return 0;
+    CodecHandle* h = ToHandle(codec);
+    // アリーナの返却バッファは次の呼び出しで上書きされるため、受け取りが遅れる非同期処理には使えない
+    if (h->useArena) return 0;
+
+    CompletionQueue* q = static_cast<CompletionQueue*>(queue);
+    const uint64_t id = g_nextAsyncId.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lk(q->mtx);
+        q->outstanding++;
+    }
+
+    auto job = [h, q, id, op, input, inSize, user]() {
+        Codec_Completion c{};
+        c.id = id;
+        c.codec = h;
+        c.op = op;
+        c.user = user;
+        c.result = RunAsyncOp(h, op, input, inSize, c.output, c.outSize) ? 1 : 0;
+        PostCompletion(q, c);
+    };
+
+    bool start = false;
+    {
+        std::lock_guard<std::mutex> lk(h->asyncMtx);
+        h->asyncJobs.push_back(std::move(job));
+        start = !h->asyncRunning;
+        h->asyncRunning = true;
+    }
+    if (start) WorkerPool::Shared()->Submit([h]() { RunAsyncJobs(h); });
+    return id;
+}
+
+size_t Codec_PollCompletions(void* queue, Codec_Completion* completions, size_t maxCount, int timeoutMs)
+{
+    if (!queue || !completions || maxCount == 0) return 0;
+    CompletionQueue* q = static_cast<CompletionQueue*>(queue);
+    std::unique_lock<std::mutex> lk(q->mtx);
+    auto ready = [q]() { return !q->done.empty() || q->outstanding == 0; };
+    if (timeoutMs < 0) q->ready.wait(lk, ready);
+    else if (timeoutMs > 0) q->ready.wait_for(lk, std::chrono::milliseconds(timeoutMs), ready);
+
+    size_t n = std::min(maxCount, q->done.size());
+    for (size_t i = 0; i < n; ++i) {
+        completions[i] = q->done.front();
+        q->done.pop_front();
+    }
+    return n;
+}
+
+bool Codec_SetThreadCount(int threads)
+{
+    if (threads < 0) return false;
+    // 現在の設定は WorkerPool::Shared() を介さずに読む（起動時の設定でプールを作らない）
+    size_t count = 0;
+    uint64_t mask = 0;
+    WorkerPool::SharedConfig(count, mask);
+    return WorkerPool::ConfigureShared((size_t)threads, mask);
+}
+
+bool Codec_SetThreadAffinity(uint64_t cpuMask)
+{
+    size_t count = 0;
+    uint64_t mask = 0;
+    WorkerPool::SharedConfig(count, mask);
+    return WorkerPool::ConfigureShared(count, cpuMask);
+}
+
+bool Codec_GetThreadStats(Codec_ThreadStats* stats)
+{
+    if (!stats) return false;
+    WorkerPoolStats s = WorkerPool::Shared()->GetStats();
+    stats->threads = (int)s.threads;
+    stats->submitted = s.submitted;
+    stats->executed = s.executed;
+    stats->steals = s.steals;
+    stats->queueDepth = s.queueDepth;
+    stats->peakQueueDepth = s.peakQueueDepth;
+    return true;
 }
 
 } // extern "C"
@@ -3,30 +3,286 @@
 #include <cstddef>
 #include <cstdint>
 
+// Windows 以外（Linux でのテスト用ビルドなど）ではエクスポート指定を無視する
+#if !defined(_WIN32) && !defined(__declspec)
+#define __declspec(x)
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 // DLL 外部公開の簡易 C API (Codec_FreeBuffer で解放が必要)
+// void* codec は Codec_Create が返すハンドル
 __declspec(dllexport) void* Codec_Create(const char* name);
 __declspec(dllexport) void  Codec_Destroy(void* codec);
 
 // 初期化：サンプリングレート、チャンネル数、ビット深度を設定
 __declspec(dllexport) bool  Codec_Initialize(void* codec, int sampleRate, int channels, int bitsPerSample);
 
+// PCM のサンプル形式（エンコード入力とデコード出力の両方に適用）
+enum Codec_SampleFormat
+{
+    CODEC_SAMPLE_S16 = 0,
+    CODEC_SAMPLE_S24 = 1,  // 3 バイト詰め
+    CODEC_SAMPLE_S32 = 2,
+    CODEC_SAMPLE_F32 = 3,  // -1.0 〜 1.0
+};
+
+// 初期化（サンプル形式指定版）。Codec_Initialize は整数 PCM のみ。
+__declspec(dllexport) bool  Codec_InitializeFormat(void* codec, int sampleRate, int channels, int sampleFormat);
+
+// PCM 側のフォーマット
+typedef struct Codec_AudioFormat
+{
+    int sampleRate;
+    int channels;
+    int sampleFormat;  // Codec_SampleFormat
+    int interleaved;   // 0: チャンネルごとに連続（呼び出しごとのバッファ単位で ch0 の全サンプル、ch1 の全サンプル…）
+} Codec_AudioFormat;
+
+// エンコード品質（LDAC の EQMID HQ / SQ / MQ）
+enum Codec_Quality
+{
+    CODEC_QUALITY_HIGH = 0,
+    CODEC_QUALITY_STANDARD = 1,
+    CODEC_QUALITY_MOBILE = 2,
+};
+
+// エンコーダ設定
+typedef struct Codec_EncoderOptions
+{
+    int quality;   // Codec_Quality
+    int mtu;       // 0 でコーデック既定値
+    int adaptive;  // 非 0: Codec_ReportLinkBudget に応じて quality を上限に品質を自動調整
+} Codec_EncoderOptions;
+
+// 初期化（フォーマット構造体版）。options が nullptr なら既定の設定（最高品質、既定 MTU、固定）
+__declspec(dllexport) bool  Codec_InitializeEx(void* codec, const Codec_AudioFormat* format, const Codec_EncoderOptions* options);
+
+// 伝送路で使える帯域（kbps）を報告する。adaptive 指定時のみ品質が変わる（次のフレームから）
+__declspec(dllexport) bool  Codec_ReportLinkBudget(void* codec, int kbps);
+
+// 現在のエンコードビットレート（kbps）。不明な場合は 0
+__declspec(dllexport) int   Codec_GetBitrate(void* codec);
+
+// コーデックの能力（バッファの事前確保やスケジューリング用）。
+// 初期化前は対応する全設定での値（上限）、初期化後はその設定での値
+enum { CODEC_MAX_SAMPLE_RATES = 16 };
+
+typedef struct Codec_Capabilities
+{
+    int sampleRates[CODEC_MAX_SAMPLE_RATES];
+    int sampleRateCount;     // 0 なら任意のレート
+    unsigned sampleFormats;  // 対応する PCM 形式のビット集合（1 << Codec_SampleFormat）
+    int maxChannels;         // 0 なら制限なし
+    int frameSamples;        // 1 フレームのチャンネルあたりサンプル数。フレーム構造が無ければ 0
+    int blockSamples;        // エンコーダが一度に消費する単位（チャンネルあたり）
+    int delaySamples;        // アルゴリズム遅延（チャンネルあたり。パケット化による待ちは含まない）
+    size_t maxFrameBytes;    // 符号化後の 1 フレームの最大バイト数。フレーム構造が無ければ 0
+    int maxBitrate;          // 最大ビットレート（kbps）。0 なら制限なし
+    int mtu;                 // 送出パケットの最大バイト数（初期化前は既定値）。パケット化しなければ 0
+} Codec_Capabilities;
+
+// ハンドルの能力
+__declspec(dllexport) bool  Codec_GetCapabilities(void* codec, Codec_Capabilities* caps);
+// 名前で指定したコーデックの初期化前の能力（ハンドル不要）
+__declspec(dllexport) bool  Codec_QueryCapabilities(const char* name, Codec_Capabilities* caps);
+
 // Encode: 入力バッファを受け取り、内部で malloc して出力ポインタを返す（outSize に出力サイズ）。
 // エラー時は nullptr を返す。
 __declspec(dllexport) uint8_t* Codec_Encode(void* codec, const void* input, size_t inSize, size_t* outSize);
 
+// EncodeStream: 任意サイズの PCM を渡す。フレームに満たない端数はコーデック内部に持ち越される。
+// 出力が無い場合（端数のみ保持した場合など）は nullptr を返し、outSize は 0 になる。
+__declspec(dllexport) uint8_t* Codec_EncodeStream(void* codec, const void* input, size_t inSize, size_t* outSize);
+
+// FlushStream: ストリーム終端。持ち越している端数と、エンコーダ内部に保持されているフレームをすべて出力する。
+__declspec(dllexport) uint8_t* Codec_FlushStream(void* codec, size_t* outSize);
+
 // デコード後のフォーマット取得
 __declspec(dllexport) bool Codec_GetLastFormat(void* codec, int* sampleRate, int* channels, int* bitsPerSample);
+// 同じく Codec_SampleFormat の値。エラー時は -1。
+__declspec(dllexport) int Codec_GetSampleFormat(void* codec);
+// 同じくフォーマット構造体（サンプル形式と並び順を含む）
+__declspec(dllexport) bool Codec_GetAudioFormat(void* codec, Codec_AudioFormat* format);
 
 // Decode: エンコード済みデータを受け取り、PCMデータを返す。
 __declspec(dllexport) uint8_t* Codec_Decode(void* codec, const void* input, size_t inSize, size_t* outSize);
 
+// Decode / DecodeInto の出力サイズ（フレームヘッダのみを走査して求める。デコードは行わない）
+__declspec(dllexport) size_t Codec_GetDecodedSize(void* codec, const void* input, size_t inSize);
+
+// フレーム索引を作ってハンドルに保持する（ヘッダのみ走査）。フレーム数と総サンプル数（チャンネルあたり）を返す。
+__declspec(dllexport) bool Codec_BuildFrameIndex(void* codec, const void* input, size_t inSize, size_t* frameCount, uint64_t* totalSamples);
+
+// 索引中のフレームの、符号化データ上のバイト位置とサンプル位置
+__declspec(dllexport) bool Codec_GetFrameInfo(void* codec, size_t frame, uint64_t* offset, uint64_t* samplePosition);
+
+// 索引の firstFrame から frameCount フレームをデコードする（Codec_BuildFrameIndex と同じ input を渡すこと）
+__declspec(dllexport) uint8_t* Codec_DecodeRange(void* codec, const void* input, size_t inSize, size_t firstFrame, size_t frameCount, size_t* outSize);
+
+// デコード時の同期統計（読み飛ばしたバイト数、再同期回数、デコードしたフレーム数）。不要な引数は nullptr 可。
+__declspec(dllexport) bool Codec_GetDecodeStats(void* codec, uint64_t* bytesSkipped, uint64_t* resyncs, uint64_t* framesDecoded);
+
+// 一括エンコード / デコードの並列度（既定 1、0 で共有ワーカープールのスレッド数）。長い入力を区間に分け、区間ごとに別ハンドルで並列処理する。
+// 区間はライブラリ共通のワーカープール（Codec_SetThreadCount）で実行される。
+// デコードは各区間の直前の数フレームを空デコードしてから出力するため、結果は単一スレッドと一致する（一致しない場合は単一スレッドでやり直す）。
+// エンコード（Codec_Encode / Codec_EncodeInto のみ）は区間の前後数フレームも符号化して捨て、各区間を終端処理してから連結するため、
+// 結果は単一スレッドと一致する。ストリーミング API は常に単一スレッド。
+__declspec(dllexport) bool Codec_SetParallelism(void* codec, int threads);
+
+// ---- 呼び出し側バッファ版（コピー無し） ----
+// output（容量 outCapacity）へ直接書き込む。成功時は *outSize に書き込んだサイズを設定して true を返す。
+// output が nullptr または容量が必要サイズ未満の場合は何もせず false を返し、*outSize に必要サイズを設定する。
+// 呼び出しごとのヒープ確保が無いのは Codec_EncodeStreamInto と Codec_DecodeInto。Codec_EncodeInto / Codec_FlushStreamInto は
+// ストリームを終端するため、LDAC では次のストリームの開始時にエンコーダの再初期化（ldacBT 内部の解放と再確保）が 1 回発生する。
+__declspec(dllexport) bool Codec_EncodeInto(void* codec, const void* input, size_t inSize, uint8_t* output, size_t outCapacity, size_t* outSize);
+__declspec(dllexport) bool Codec_EncodeStreamInto(void* codec, const void* input, size_t inSize, uint8_t* output, size_t outCapacity, size_t* outSize);
+__declspec(dllexport) bool Codec_FlushStreamInto(void* codec, uint8_t* output, size_t outCapacity, size_t* outSize);
+__declspec(dllexport) bool Codec_DecodeInto(void* codec, const void* input, size_t inSize, uint8_t* output, size_t outCapacity, size_t* outSize);
+
+// エンコード / デコードの出力サイズ上限（入力サイズのみからの最悪値）。初期化前やエラー時は 0。
+// Codec_DecodeInto に必要なサイズは Codec_GetDecodedSize で正確に求められる。
+__declspec(dllexport) size_t Codec_GetMaxEncodedSize(void* codec, size_t inSize);
+__declspec(dllexport) size_t Codec_GetMaxDecodedSize(void* codec, size_t inSize);
+
+// ---- メモリ管理 ----
+typedef void* (*Codec_AllocFunc)(size_t size, void* user);
+typedef void  (*Codec_FreeFunc)(void* ptr, void* user);
+
+// 返却バッファとアリーナの確保に使うアロケータを設定する。
+// codec が nullptr の場合はライブラリ全体の既定値（ハンドル個別の設定が無いものに適用）。
+// allocFunc / freeFunc を両方 nullptr にすると malloc / free に戻る。既定値の変更は起動時に行うこと。
+__declspec(dllexport) bool Codec_SetAllocator(void* codec, Codec_AllocFunc allocFunc, Codec_FreeFunc freeFunc, void* user);
+
+// ハンドル専用のバンプアリーナを有効化する（initialBytes は初期容量、0 なら初回呼び出しで決まる）。
+// 有効時、Codec_Encode / Codec_EncodeStream / Codec_FlushStream / Codec_Decode の返却バッファはアリーナから切り出され、
+// 同じハンドルに対する次の呼び出しまで有効。Codec_FreeBuffer は不要（呼んでも何もしない）。
+// アリーナは呼び出しごとに巻き戻され、容量はピーク使用量まで自動で拡張される。
+// 呼び出しの合間にアロケータを変更する（Codec_SetAllocator）か、現在の容量を超える initialBytes で
+// 設定し直すと、直前の呼び出しが返したバッファは無効になる。
+__declspec(dllexport) bool Codec_SetArena(void* codec, bool enable, size_t initialBytes);
+
+// アリーナの現在容量と、1 回の呼び出しで使用した最大バイト数（容量決定の目安）。アリーナ無効時は false。
+__declspec(dllexport) bool Codec_GetArenaStats(void* codec, size_t* capacity, size_t* highWater);
+
 // Codec 関数内で確保されたバッファを解放する
 __declspec(dllexport) void Codec_FreeBuffer(uint8_t* buffer);
 
+// ---- インスタンスプール ----
+// 初期化済みのハンドルを取得する（Codec_Create + Codec_InitializeEx と等価。options は nullptr 可）。
+// name と設定が同じで返却済みのインスタンスがあれば、ハンドルの確保と初期化を省いて再利用する。
+// Codec_Destroy で初期化直後の状態に戻してプールへ返却される（上限を超える分は破棄）。
+// 取得後に Codec_Initialize* で設定を変えたハンドルは、Codec_Destroy で通常どおり破棄される。
+__declspec(dllexport) void* Codec_Acquire(const char* name, const Codec_AudioFormat* format, const Codec_EncoderOptions* options);
+
+// プールに待機させるインスタンス数の上限（設定ごと / 全体。既定は 8 / 64）。0 でプールを使わない。
+__declspec(dllexport) void Codec_SetPoolLimits(size_t perKey, size_t total);
+
+typedef struct Codec_PoolStats
+{
+    uint64_t hits;       // 待機中のインスタンスを再利用した回数
+    uint64_t misses;     // 新規に作成・初期化した回数
+    uint64_t recycled;   // 返却されてプールに戻った回数
+    uint64_t discarded;  // 上限超過などで破棄した回数
+    size_t idle;         // 現在待機中のインスタンス数
+} Codec_PoolStats;
+
+__declspec(dllexport) bool Codec_GetPoolStats(Codec_PoolStats* stats);
+
+// 待機中のインスタンスをすべて破棄する
+__declspec(dllexport) void Codec_ClearPool(void);
+
+// ---- バッチ ----
+// 複数ストリームのエンコードを 1 回の呼び出しでまとめて行うためのジョブ
+typedef struct Codec_EncodeJob
+{
+    // 入力
+    void* codec;           // ジョブごとに別のハンドルを使うこと（同じハンドルを複数のジョブに含めない）
+    const void* input;
+    size_t inSize;
+    uint8_t* output;       // 容量 outCapacity（Codec_GetMaxEncodedSize 以上）
+    size_t outCapacity;
+    int stream;            // 非 0: Codec_EncodeStreamInto 相当（端数を持ち越す）、0: Codec_EncodeInto 相当
+    // 出力
+    size_t outSize;        // 書き込んだサイズ。容量不足の場合は必要サイズ
+    int result;            // 非 0: 成功
+    uint64_t queueNs;      // 呼び出しからジョブの開始までの待ち時間（ナノ秒）
+    uint64_t runNs;        // エンコードにかかった時間（ナノ秒）
+} Codec_EncodeJob;
+
+// jobs の count 個のジョブをライブラリ内部の共有ワーカープールで並列に実行し、すべての完了を待つ。
+// ストリームごとにスレッドを用意する代わりに使う（呼び出し元スレッドも実行に加わる）。
+// すべてのジョブが成功したら true。
+__declspec(dllexport) bool Codec_EncodeBatch(Codec_EncodeJob* jobs, size_t count);
+
+// ---- 非同期 ----
+// 処理をライブラリ内部のワーカーに任せ、結果を完了キューから受け取る（イベントループ向け）。
+// 同じハンドルへの投入は投入順に 1 つずつ実行される。完了を受け取るまで input は有効にしておき、
+// そのハンドルに対して同期 API を呼ばないこと。アリーナを有効にしたハンドルには投入できない。
+enum Codec_AsyncOp
+{
+    CODEC_OP_ENCODE = 0,         // Codec_Encode 相当
+    CODEC_OP_ENCODE_STREAM = 1,  // Codec_EncodeStream 相当
+    CODEC_OP_FLUSH_STREAM = 2,   // Codec_FlushStream 相当（input は無視）
+    CODEC_OP_DECODE = 3,         // Codec_Decode 相当
+};
+
+typedef struct Codec_Completion
+{
+    uint64_t id;       // Codec_Submit の戻り値
+    void* codec;
+    int op;            // Codec_AsyncOp
+    void* user;        // Codec_Submit に渡した値
+    uint8_t* output;   // Codec_FreeBuffer で解放する。出力が無ければ nullptr
+    size_t outSize;
+    int result;        // 非 0: 成功（ストリームの端数だけで出力が無い場合も成功）
+} Codec_Completion;
+
+// 完了が積まれるたびにワーカースレッドから呼ばれる（イベントループを起こす用途。重い処理はしないこと）。
+// 通知の中で完了したハンドルを Codec_Destroy してもよい（投入済みの残りの処理を終えてから破棄される）。
+// Codec_DestroyCompletionQueue は未完了の処理を待つため、通知の中から呼ばないこと
+typedef void (*Codec_CompletionNotify)(void* user);
+
+// 完了キューを作成する（notify は nullptr 可）
+__declspec(dllexport) void* Codec_CreateCompletionQueue(Codec_CompletionNotify notify, void* user);
+// 投入済みの処理がすべて終わるのを待ってから破棄する。受け取られていない出力も解放される
+__declspec(dllexport) void  Codec_DestroyCompletionQueue(void* queue);
+
+// 処理を投入する。戻り値は完了と対応付けるための ID（失敗時は 0）
+__declspec(dllexport) uint64_t Codec_Submit(void* queue, void* codec, int op, const void* input, size_t inSize, void* user);
+
+// 完了を最大 maxCount 件取り出して個数を返す。timeoutMs: 0 なら待たない、負なら 1 件以上届くまで待つ
+// （投入済みで未完了の処理が無ければ待たずに戻る）
+__declspec(dllexport) size_t Codec_PollCompletions(void* queue, Codec_Completion* completions, size_t maxCount, int timeoutMs);
+
+// ---- ワーカースレッド ----
+// 並列処理（Codec_SetParallelism による区間分割、バッチ、非同期 API）はすべてライブラリ共通の
+// ワークスティーリング方式のワーカープール 1 つで実行される（既定はコア数のスレッド）。
+
+// ワーカーのスレッド数を設定する（0 でコア数）。プールは作り直され、それまでのプールは残りを実行してから止まる。
+// まだ一度も使われていなければスレッドは起動せず、初回使用時にこの設定で作られる。
+// 起動時など処理の少ないときに呼ぶこと。コールバックなどワーカー上からは呼べない（false）
+__declspec(dllexport) bool Codec_SetThreadCount(int threads);
+
+// ワーカーを固定する CPU のビット集合（ワーカー i は i 番目のビットの CPU、一巡したら先頭から）。0 で固定しない。
+// Codec_SetThreadCount と同じくプールを作り直す
+__declspec(dllexport) bool Codec_SetThreadAffinity(uint64_t cpuMask);
+
+typedef struct Codec_ThreadStats
+{
+    int threads;
+    uint64_t submitted;       // 投入されたタスク数
+    uint64_t executed;        // 実行したタスク数（完了待ちのスレッドが手伝った分を含む）
+    uint64_t steals;          // 他のワーカーのキューから取り出した回数
+    size_t queueDepth;        // 現在キューに残っているタスク数
+    size_t peakQueueDepth;    // キューに残っていたタスク数の最大値
+} Codec_ThreadStats;
+
+// 現在のプールの統計（Codec_SetThreadCount / Codec_SetThreadAffinity で作り直すと 0 に戻る）
+__declspec(dllexport) bool Codec_GetThreadStats(Codec_ThreadStats* stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -1,5 +1,8 @@
 #pragma once
 
+#ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN             // Windows ヘッダーからほとんど使用されていない部分を除外する
+#define NOMINMAX                        // min/max マクロを抑止する (std::min / std::max と衝突するため)
 // Windows ヘッダー ファイル
 #include <windows.h>
+#endif
@@ -1,11 +1,107 @@
 #pragma once
 
 #include <cstdint>
+#include <span>
 #include <string>
 #include <vector>
 
 namespace CodecTest
 {
+    // PCM のサンプル形式（エンコード入力とデコード出力の両方に使う。いずれもリトルエンディアン、インターリーブ）
+    enum class SampleFormat : int
+    {
+        S16 = 0,
+        S24 = 1,   // 3 バイト詰め
+        S32 = 2,
+        F32 = 3,   // -1.0 〜 1.0
+    };
+
+    inline int SampleFormatBytes(SampleFormat format)
+    {
+        return format == SampleFormat::S16 ? 2 : format == SampleFormat::S24 ? 3 : 4;
+    }
+
+    // PCM 側のフォーマット
+    struct AudioFormat
+    {
+        int sampleRate{ 0 };
+        int channels{ 0 };
+        SampleFormat sampleFormat{ SampleFormat::S16 };
+        // false: チャンネルごとに連続（planar）。1 回の呼び出しで渡す / 返すバッファ単位で、
+        // 先頭からチャンネル 0 の全サンプル、チャンネル 1 の全サンプル…の順に並ぶ
+        bool interleaved{ true };
+    };
+
+    // エンコード品質（LDAC では EQMID の HQ / SQ / MQ に対応）
+    enum class EncodeQuality : int
+    {
+        High = 0,
+        Standard = 1,
+        Mobile = 2,
+    };
+
+    // エンコーダ設定（Initialize 時に指定）
+    struct EncoderOptions
+    {
+        EncodeQuality quality{ EncodeQuality::High };
+        int mtu{ 0 };            // 送出パケットサイズ。0 でコーデック既定値
+        // true: ReportLinkBudget の報告に応じて quality を上限として品質を自動で上下させる
+        bool adaptive{ false };
+    };
+
+    // コーデックの能力（バッファの事前確保やスケジューリング用）。
+    // Initialize 前は対応する全設定での値（上限）、Initialize 後はその設定での値
+    struct CodecCapabilities
+    {
+        std::vector<int> sampleRates;             // 対応サンプルレート。空なら任意
+        std::vector<SampleFormat> sampleFormats;  // 対応する PCM 形式
+        int maxChannels{ 0 };       // 0 なら制限なし
+        int frameSamples{ 0 };      // 1 フレームのチャンネルあたりサンプル数。フレーム構造が無ければ 0
+        int blockSamples{ 0 };      // エンコーダが一度に消費する単位（チャンネルあたり）。端数は次の呼び出しへ持ち越される
+        int delaySamples{ 0 };      // アルゴリズム遅延（チャンネルあたり。パケット化による待ちは含まない）
+        size_t maxFrameBytes{ 0 };  // 符号化後の 1 フレームの最大バイト数。フレーム構造が無ければ 0
+        int maxBitrate{ 0 };        // 最大ビットレート（kbps）。0 なら制限なし
+        int mtu{ 0 };               // 送出パケットの最大バイト数（Initialize 前は既定値）。パケット化しなければ 0
+    };
+
+    // デコード時の同期統計（Reset でクリア）
+    struct DecodeStats
+    {
+        uint64_t bytesSkipped{ 0 };  // フレームとして消費されなかったバイト数
+        uint64_t resyncs{ 0 };       // 同期を失った後に再びフレームを検出した回数
+        uint64_t framesDecoded{ 0 };
+    };
+
+    // フレーム索引の 1 要素
+    struct FrameIndexEntry
+    {
+        uint64_t offset{ 0 };          // 符号化データ先頭からのバイト位置
+        uint64_t samplePosition{ 0 };  // フレーム先頭のサンプル位置（チャンネルあたり）
+        uint64_t pcmPosition{ 0 };     // フレーム先頭の出力位置（全チャンネル分のサンプル数）
+        uint32_t bytes{ 0 };
+        uint32_t samples{ 0 };         // チャンネルあたりのサンプル数
+        uint32_t channels{ 0 };        // このフレームのチャンネル数（ストリーム途中で切り替わり得る）
+    };
+
+    // 符号化データのフレーム索引（ヘッダのみを走査して作る）。シークと出力サイズの算出に使う。
+    struct FrameIndex
+    {
+        std::vector<FrameIndexEntry> frames;
+        int sampleRate{ 0 };
+        int channels{ 0 };             // 先頭フレームのチャンネル数
+        uint64_t totalSamples{ 0 };    // チャンネルあたり
+        uint64_t pcmSamples{ 0 };      // 全チャンネル分
+
+        uint64_t PcmBytes(int bytesPerSample) const { return pcmSamples * bytesPerSample; }
+        // frames[first, last) のデコード結果のバイト数
+        uint64_t PcmBytes(size_t first, size_t last, int bytesPerSample) const
+        {
+            if (first >= last || last > frames.size()) return 0;
+            const FrameIndexEntry& end = frames[last - 1];
+            return (end.pcmPosition + (uint64_t)end.samples * end.channels - frames[first].pcmPosition) * bytesPerSample;
+        }
+    };
+
     // シンプルな音声コーデックインターフェイス
     class IAudioCodec
     {
@@ -13,17 +109,96 @@ namespace CodecTest
         virtual ~IAudioCodec() = default;
 
         // 初期化：sampleRate, channels 等は実装側で保持する
-        virtual bool Initialize(int sampleRate, int channels, int bitsPerSample) = 0;
+        // format はエンコードに渡す PCM と、デコードで返す PCM の形式
+        virtual bool Initialize(const AudioFormat& format, const EncoderOptions& options) = 0;
+
+        bool Initialize(const AudioFormat& format) { return Initialize(format, EncoderOptions{}); }
+
+        bool Initialize(int sampleRate, int channels, SampleFormat sampleFormat)
+        {
+            AudioFormat format;
+            format.sampleRate = sampleRate;
+            format.channels = channels;
+            format.sampleFormat = sampleFormat;
+            return Initialize(format);
+        }
+
+        // 整数 PCM 用（bitsPerSample は 16 / 24 / 32）
+        bool Initialize(int sampleRate, int channels, int bitsPerSample)
+        {
+            if (bitsPerSample == 16) return Initialize(sampleRate, channels, SampleFormat::S16);
+            if (bitsPerSample == 24) return Initialize(sampleRate, channels, SampleFormat::S24);
+            if (bitsPerSample == 32) return Initialize(sampleRate, channels, SampleFormat::S32);
+            return false;
+        }
 
         // エンコード（PCMデータ -> 圧縮データ）
         // 戻り値はバイト列。エラー時は空を返す。
+        // EncodeStream + FlushStream を 1 回で行うのと等価。
         virtual std::vector<uint8_t> Encode(const void* pcmData, size_t pcmBytes) = 0;
 
+        // ストリーミングエンコード：任意サイズの PCM を受け取り、フレームに満たない端数は内部に保持して次回に持ち越す。
+        // FlushStream までの出力を連結すると、同じ PCM を一括で Encode した結果と一致する。
+        virtual std::vector<uint8_t> EncodeStream(const void* pcmData, size_t pcmBytes) = 0;
+
+        // ストリーム終端：保持している端数とエンコーダ内部の未出力フレームを出力して持ち越し状態をクリアする
+        virtual std::vector<uint8_t> FlushStream() = 0;
+
         // デコード（圧縮データ -> PCMデータ）
         virtual std::vector<uint8_t> Decode(const void* codedData, size_t codedBytes) = 0;
 
+        // 呼び出し側バッファへ直接書き込む版。EncodeStreamInto / DecodeInto は定常状態でヒープ確保を行わない。
+        // EncodeInto / FlushStreamInto はストリームを終端するため、LDAC では次のストリームの開始時に
+        // ldacBT の再初期化（ライブラリ内部の解放と再確保）が 1 回発生する。
+        // out にはエンコードでは MaxEncodedBytes、デコードでは DecodedBytes（または MaxDecodedBytes）以上の容量を渡すこと。
+        // written に書き込んだバイト数を返す。容量不足やエラー時は false（それまでの出力は有効）。
+        virtual bool EncodeInto(const void* pcmData, size_t pcmBytes, std::span<uint8_t> out, size_t& written) = 0;
+        virtual bool EncodeStreamInto(const void* pcmData, size_t pcmBytes, std::span<uint8_t> out, size_t& written) = 0;
+        virtual bool FlushStreamInto(std::span<uint8_t> out, size_t& written) = 0;
+        virtual bool DecodeInto(const void* codedData, size_t codedBytes, std::span<uint8_t> out, size_t& written) = 0;
+
+        // 1 回の呼び出しで出力され得る最大バイト数（初期化後に有効）
+        virtual size_t MaxEncodedBytes(size_t pcmBytes) const = 0;
+        virtual size_t MaxDecodedBytes(size_t codedBytes) const = 0;
+
+        // codedData を Decode / DecodeInto した場合の出力バイト数（ヘッダ走査による。デコードは行わない）
+        virtual size_t DecodedBytes(const void* codedData, size_t codedBytes) const = 0;
+
+        // フレーム索引を作る。フレーム構造を持たないコーデックやフレームが見つからない場合は false。
+        virtual bool BuildFrameIndex(const void* codedData, size_t codedBytes, FrameIndex& index) const = 0;
+
+        // 索引の firstFrame から frameCount フレーム分をデコードする（途中からのデコード）。
+        // index は同じ codedData から BuildFrameIndex で作ったものを渡すこと。
+        virtual std::vector<uint8_t> DecodeRange(const void* codedData, size_t codedBytes, const FrameIndex& index, size_t firstFrame, size_t frameCount) = 0;
+        virtual bool DecodeRangeInto(const void* codedData, size_t codedBytes, const FrameIndex& index, size_t firstFrame, size_t frameCount, std::span<uint8_t> out, size_t& written) = 0;
+
+        // デコード時の同期統計
+        virtual DecodeStats GetDecodeStats() const = 0;
+
+        // 伝送路で使える帯域（kbps）を報告する。EncoderOptions::adaptive のとき、
+        // 帯域に収まるよう品質を下げ、余裕が続けば上げる（次のフレームから反映）
+        virtual void ReportLinkBudget(int kbps) = 0;
+
+        // 現在のエンコードビットレート（kbps）。固定レートでないコーデックや初期化前は 0
+        virtual int GetBitrate() const = 0;
+
+        // コーデックの能力（初期化前でも取得できる）
+        virtual CodecCapabilities GetCapabilities() const = 0;
+
+        // 一括エンコード / デコードの並列度を設定（1: 単一スレッド, 0: 共有ワーカープールのスレッド数に合わせる）
+        // 並列処理はライブラリ共通のワーカープール（WorkerPool::Shared）で行う。並列化できないコーデックは無視してよい
+        virtual void SetParallelism(int threads) = 0;
+
         // 最後に処理した（あるいは設定された）フォーマットを取得
         virtual void GetFormat(int& sampleRate, int& channels, int& bitsPerSample) const = 0;
+        // 同じく PCM 側のフォーマット（サンプル形式と並び順を含む）
+        virtual AudioFormat GetAudioFormat() const = 0;
+        SampleFormat GetSampleFormat() const { return GetAudioFormat().sampleFormat; }
+
+        // 初期化直後の状態に戻す。フォーマットと EncoderOptions は維持し、確保済みのハンドル等は再利用する。
+        // ストリームの持ち越し、デコード統計、適応制御の状態、SetParallelism の設定はクリアされる。
+        // 未初期化や失敗時は false（その場合は Initialize し直すか破棄すること）
+        virtual bool Recycle() = 0;
 
         // リセット / クローズ
         virtual void Reset() = 0;
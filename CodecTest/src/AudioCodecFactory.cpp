@@ -1,16 +1,54 @@
 #include "../pch.h"
 #include "AudioCodecFactory.h"
+#include <atomic>
 #include <map>
 #include <mutex>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
 
 namespace CodecTest
 {
+    namespace
+    {
+        struct CodecPoolKeyLess
+        {
+            static auto Tie(const CodecPoolKey& k)
+            {
+                return std::tie(k.name, k.format.sampleRate, k.format.channels, k.format.sampleFormat, k.format.interleaved,
+                    k.options.quality, k.options.mtu, k.options.adaptive);
+            }
+            bool operator()(const CodecPoolKey& a, const CodecPoolKey& b) const { return Tie(a) < Tie(b); }
+        };
+    }
+
+    // 登録済みコーデックの表。公開後は変更しない
+    struct CodecRegistry
+    {
+        std::unordered_map<std::string, CodecCreator> creators;
+    };
+
     struct AudioCodecFactory::Impl
     {
-        std::map<std::string, CodecCreator> registry;
-        mutable std::mutex mtx;
+        // 最新の表。Create はこれを読むだけ
+        std::atomic<const CodecRegistry*> registry{ nullptr };
+        // これまでに公開した表。読み手が古い表を参照中でも解放しないよう、すべて保持する
+        std::vector<std::unique_ptr<const CodecRegistry>> versions;
+        std::mutex registerMtx;
+
+        // 初期化済みで待機中のインスタンス（キーごと）
+        std::map<CodecPoolKey, std::vector<std::unique_ptr<IAudioCodec>>, CodecPoolKeyLess> pool;
+        size_t perKeyLimit{ 8 };
+        size_t totalLimit{ 64 };
+        CodecPoolStats stats;
+        mutable std::mutex poolMtx;
     };
 
+    AudioCodecFactory::AudioCodecFactory()
+        : m_impl(new Impl())
+    {
+    }
+
     AudioCodecFactory& AudioCodecFactory::Instance() noexcept
     {
         static AudioCodecFactory instance;
@@ -19,19 +57,109 @@ namespace CodecTest
 
     bool AudioCodecFactory::Register(const std::string& name, CodecCreator creator) noexcept
     {
-        if (!m_impl) m_impl = new Impl();
-        std::lock_guard<std::mutex> lk(m_impl->mtx);
-        if (m_impl->registry.count(name)) return false;
-        m_impl->registry.emplace(name, std::move(creator));
+        if (!creator) return false;
+        // 登録同士は直列化し、現在の表の複製に追加したものを公開する
+        std::lock_guard<std::mutex> lk(m_impl->registerMtx);
+        const CodecRegistry* current = m_impl->registry.load(std::memory_order_relaxed);
+        if (current && current->creators.count(name)) return false;
+
+        auto next = current ? std::make_unique<CodecRegistry>(*current) : std::make_unique<CodecRegistry>();
+        next->creators.emplace(name, creator);
+        m_impl->registry.store(next.get(), std::memory_order_release);
+        m_impl->versions.push_back(std::move(next));
         return true;
     }
 
     std::unique_ptr<IAudioCodec> AudioCodecFactory::Create(const std::string& name) const noexcept
     {
-        if (!m_impl) return nullptr;
-        std::lock_guard<std::mutex> lk(m_impl->mtx);
-        auto it = m_impl->registry.find(name);
-        if (it == m_impl->registry.end()) return nullptr;
+        const CodecRegistry* registry = m_impl->registry.load(std::memory_order_acquire);
+        if (!registry) return nullptr;
+        auto it = registry->creators.find(name);
+        if (it == registry->creators.end()) return nullptr;
         return it->second();
     }
+
+    bool AudioCodecFactory::GetCapabilities(const std::string& name, CodecCapabilities& caps) const noexcept
+    {
+        // 生成直後のインスタンスはハンドル等を確保していないので安価
+        std::unique_ptr<IAudioCodec> codec = Create(name);
+        if (!codec) return false;
+        caps = codec->GetCapabilities();
+        return true;
+    }
+
+    std::unique_ptr<IAudioCodec> AudioCodecFactory::Acquire(const CodecPoolKey& key) noexcept
+    {
+        {
+            std::lock_guard<std::mutex> lk(m_impl->poolMtx);
+            auto it = m_impl->pool.find(key);
+            if (it != m_impl->pool.end() && !it->second.empty()) {
+                std::unique_ptr<IAudioCodec> codec = std::move(it->second.back());
+                it->second.pop_back();
+                m_impl->stats.idle--;
+                m_impl->stats.hits++;
+                return codec;
+            }
+        }
+
+        // 作成と初期化はロックの外で行う。失敗した分はミスに数えない
+        std::unique_ptr<IAudioCodec> codec = Create(key.name);
+        if (!codec || !codec->Initialize(key.format, key.options)) return nullptr;
+        std::lock_guard<std::mutex> lk(m_impl->poolMtx);
+        m_impl->stats.misses++;
+        return codec;
+    }
+
+    void AudioCodecFactory::Release(const CodecPoolKey& key, std::unique_ptr<IAudioCodec> codec) noexcept
+    {
+        if (!codec) return;
+
+        const bool reusable = codec->Recycle();
+        std::lock_guard<std::mutex> lk(m_impl->poolMtx);
+        if (reusable && m_impl->stats.idle < m_impl->totalLimit) {
+            auto& idle = m_impl->pool[key];
+            if (idle.size() < m_impl->perKeyLimit) {
+                idle.push_back(std::move(codec));
+                m_impl->stats.idle++;
+                m_impl->stats.recycled++;
+                return;
+            }
+        }
+        m_impl->stats.discarded++;
+    }
+
+    void AudioCodecFactory::SetPoolLimits(size_t perKey, size_t total) noexcept
+    {
+        std::vector<std::unique_ptr<IAudioCodec>> dropped;
+        {
+            std::lock_guard<std::mutex> lk(m_impl->poolMtx);
+            m_impl->perKeyLimit = perKey;
+            m_impl->totalLimit = total;
+            for (auto& [k, idle] : m_impl->pool) {
+                while (!idle.empty() && (idle.size() > perKey || m_impl->stats.idle > total)) {
+                    dropped.push_back(std::move(idle.back()));
+                    idle.pop_back();
+                    m_impl->stats.idle--;
+                    m_impl->stats.discarded++;
+                }
+            }
+        }
+        // 破棄（ハンドルの解放）はロックの外で行う
+    }
+
+    CodecPoolStats AudioCodecFactory::GetPoolStats() const noexcept
+    {
+        std::lock_guard<std::mutex> lk(m_impl->poolMtx);
+        return m_impl->stats;
+    }
+
+    void AudioCodecFactory::ClearPool() noexcept
+    {
+        decltype(m_impl->pool) dropped;
+        {
+            std::lock_guard<std::mutex> lk(m_impl->poolMtx);
+            dropped.swap(m_impl->pool);
+            m_impl->stats.idle = 0;
+        }
+    }
 }
\ No newline at end of file
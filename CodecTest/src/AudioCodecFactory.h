@@ -1,15 +1,36 @@
 #pragma once
 
 #include "../include/IAudioCodec.h"
-#include <functional>
+#include <cstdint>
 #include <memory>
 #include <string>
 
 namespace CodecTest
 {
-    using CodecCreator = std::function<std::unique_ptr<IAudioCodec>()>;
+    // 生成関数（キャプチャ無しのラムダも可）
+    using CodecCreator = std::unique_ptr<IAudioCodec>(*)();
+
+    // プールのキー：コーデック名と Initialize に渡す設定の組
+    struct CodecPoolKey
+    {
+        std::string name;
+        AudioFormat format;
+        EncoderOptions options;
+    };
+
+    // プールの統計（ClearPool ではクリアされない）
+    struct CodecPoolStats
+    {
+        uint64_t hits{ 0 };       // 待機中のインスタンスを渡した回数
+        uint64_t misses{ 0 };     // 新規に作成・初期化した回数
+        uint64_t recycled{ 0 };   // 返却されてプールに戻った回数
+        uint64_t discarded{ 0 };  // 上限超過や Recycle 失敗で破棄した回数
+        size_t idle{ 0 };         // 現在待機中のインスタンス数
+    };
 
     // 単純なレジストリ／ファクトリ
+    // 登録は起動時（静的初期化）に行う想定。登録のたびに表を作り直して差し替えるため、
+    // Create はロックを取らずに参照できる（複数スレッドから同時に呼んでも互いに待たない）
     class AudioCodecFactory
     {
     public:
@@ -17,9 +38,24 @@ namespace CodecTest
 
         bool Register(const std::string& name, CodecCreator creator) noexcept;
         std::unique_ptr<IAudioCodec> Create(const std::string& name) const noexcept;
+        // 未初期化時の能力（対応する全設定での値）。未登録の名前なら false
+        bool GetCapabilities(const std::string& name, CodecCapabilities& caps) const noexcept;
+
+        // 初期化済みのインスタンスを取得する。同じキーで返却されたものがあれば再利用し、
+        // なければ Create して Initialize する。失敗時は nullptr
+        std::unique_ptr<IAudioCodec> Acquire(const CodecPoolKey& key) noexcept;
+        // Acquire したインスタンスを返却する。Recycle して同じキーで待機させ、上限を超える分は破棄する。
+        // 返却後に別の設定で Initialize し直したものは key と一致しないので返却しないこと
+        void Release(const CodecPoolKey& key, std::unique_ptr<IAudioCodec> codec) noexcept;
+
+        // 待機させるインスタンス数の上限（キーごと / 全体）。超過分はすぐに破棄する
+        void SetPoolLimits(size_t perKey, size_t total) noexcept;
+        CodecPoolStats GetPoolStats() const noexcept;
+        // 待機中のインスタンスをすべて破棄する
+        void ClearPool() noexcept;
 
     private:
-        AudioCodecFactory() = default;
+        AudioCodecFactory();
         ~AudioCodecFactory() = default;
         AudioCodecFactory(const AudioCodecFactory&) = delete;
         AudioCodecFactory& operator=(const AudioCodecFactory&) = delete;
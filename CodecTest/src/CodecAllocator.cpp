@@ -0,0 +1,117 @@
+#include "../pch.h"
+#include "CodecAllocator.h"
+#include <algorithm>
+#include <cstdlib>
+
+namespace CodecTest
+{
+    namespace {
+        constexpr size_t kArenaAlign = alignof(std::max_align_t);
+
+        size_t AlignUp(size_t n) noexcept
+        {
+            return (n + kArenaAlign - 1) & ~(kArenaAlign - 1);
+        }
+    }
+
+    void* CodecAllocator::Allocate(size_t size) const noexcept
+    {
+        if (IsDefault()) return std::malloc(size);
+        return alloc(size, user);
+    }
+
+    void CodecAllocator::Free(void* ptr) const noexcept
+    {
+        if (!ptr) return;
+        if (IsDefault()) std::free(ptr);
+        else free(ptr, user);
+    }
+
+    BumpArena::~BumpArena()
+    {
+        Release();
+    }
+
+    void BumpArena::SetAllocator(const CodecAllocator& allocator) noexcept
+    {
+        if (allocator == m_allocator) return;
+        Release();
+        m_allocator = allocator;
+    }
+
+    bool BumpArena::Reserve(size_t bytes) noexcept
+    {
+        bytes = AlignUp(bytes);
+        if (bytes <= m_capacity) return true;
+
+        // 切り出し済みのブロックは移動できないので、サイクルを終えてから作り直す
+        m_highWater = HighWater();
+        for (void* p : m_overflow) m_allocator.Free(p);
+        m_overflow.clear();
+        m_overflowBytes = 0;
+        m_used = 0;
+
+        uint8_t* base = static_cast<uint8_t*>(m_allocator.Allocate(bytes));
+        if (!base) return false;
+        m_allocator.Free(m_base);
+        m_base = base;
+        m_capacity = bytes;
+        return true;
+    }
+
+    void* BumpArena::Allocate(size_t size) noexcept
+    {
+        size = AlignUp(size);
+        if (m_base && size <= m_capacity - m_used)
+        {
+            void* p = m_base + m_used;
+            m_used += size;
+            return p;
+        }
+
+        // 容量不足：今回のサイクルだけ個別に確保する
+        void* p = m_allocator.Allocate(size);
+        if (!p) return nullptr;
+        m_overflow.push_back(p);
+        m_overflowBytes += size;
+        return p;
+    }
+
+    void BumpArena::Shrink(void* block, size_t oldSize, size_t newSize) noexcept
+    {
+        uint8_t* p = static_cast<uint8_t*>(block);
+        // 本体の末尾ブロックのみ縮められる
+        if (!m_base || p < m_base || p + AlignUp(oldSize) != m_base + m_used) return;
+        m_used -= AlignUp(oldSize) - AlignUp(newSize);
+    }
+
+    void BumpArena::Reset() noexcept
+    {
+        m_highWater = HighWater();
+        m_used = 0;
+        if (m_overflow.empty()) return;
+
+        for (void* p : m_overflow) m_allocator.Free(p);
+        m_overflow.clear();
+        m_overflowBytes = 0;
+
+        // 次回以降はピークまで本体だけで賄う
+        Reserve(m_highWater);
+    }
+
+    void BumpArena::Release() noexcept
+    {
+        for (void* p : m_overflow) m_allocator.Free(p);
+        m_overflow.clear();
+        m_overflowBytes = 0;
+        m_allocator.Free(m_base);
+        m_base = nullptr;
+        m_capacity = 0;
+        m_used = 0;
+    }
+
+    size_t BumpArena::HighWater() const noexcept
+    {
+        return std::max(m_highWater, m_used + m_overflowBytes);
+    }
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace CodecTest
+{
+    using AllocFunc = void* (*)(size_t size, void* user);
+    using FreeFunc = void (*)(void* ptr, void* user);
+
+    // 差し替え可能なアロケータ（alloc / free のどちらかが nullptr なら malloc / free を使う）
+    struct CodecAllocator
+    {
+        AllocFunc alloc{ nullptr };
+        FreeFunc free{ nullptr };
+        void* user{ nullptr };
+
+        bool IsDefault() const noexcept { return alloc == nullptr || free == nullptr; }
+        bool operator==(const CodecAllocator&) const noexcept = default;
+        void* Allocate(size_t size) const noexcept;
+        void Free(void* ptr) const noexcept;
+    };
+
+    // 呼び出しごとに Reset して使い回すバンプアリーナ。
+    // 容量を超えた分は一時的に個別確保し、次の Reset でピーク値まで本体を拡張する。
+    // 定常状態では確保・解放が発生しない。
+    class BumpArena
+    {
+    public:
+        BumpArena() = default;
+        ~BumpArena();
+        BumpArena(const BumpArena&) = delete;
+        BumpArena& operator=(const BumpArena&) = delete;
+
+        // 使用するアロケータを設定する（変わる場合のみ、確保済みのメモリは解放される）
+        void SetAllocator(const CodecAllocator& allocator) noexcept;
+        // 本体を指定サイズ以上で確保しておく。サイクルの途中（Reset 前）に拡張すると、
+        // それまでに切り出したブロックは無効になる
+        bool Reserve(size_t bytes) noexcept;
+
+        void* Allocate(size_t size) noexcept;
+        // 直前に確保したブロックを newSize に縮める（末尾を次の確保に回す）
+        void Shrink(void* block, size_t oldSize, size_t newSize) noexcept;
+        void Reset() noexcept;
+        void Release() noexcept;
+
+        size_t Capacity() const noexcept { return m_capacity; }
+        // 1 サイクル（Reset 間）で使用した最大バイト数
+        size_t HighWater() const noexcept;
+
+    private:
+        CodecAllocator m_allocator;
+        uint8_t* m_base{ nullptr };
+        size_t m_capacity{ 0 };
+        size_t m_used{ 0 };
+        size_t m_overflowBytes{ 0 };
+        size_t m_highWater{ 0 };
+        std::vector<void*> m_overflow;
+    };
+}
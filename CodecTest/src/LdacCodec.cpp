@@ -1,19 +1,109 @@
 #include "../pch.h"
 #include "LdacCodec.h"
 #include "AudioCodecFactory.h"
+#include "LdacFrame.h"
+#include "WorkerPool.h"
 #include "libldac/inc/ldacBT.h"
 extern "C" {
 #include "libldacdec/ldacdec.h"
 }
 #include <vector>
+#include <span>
 #include <cstring>
 #include <algorithm>
+#include <cmath>
 #include <memory>
 
 namespace CodecTest
 {
+    namespace {
+
+        // libldacdec's float PCM is on the int16 scale (pcmFloatToShort only rounds and clamps)
+        constexpr float kDecoderPcmScale = 1.0f / 32768.0f;
+
+        // Interleaves one decoded frame from the decoder's float channels into out
+        // (S24 / S32 / F32). Returns the bytes written.
+        size_t ConvertFramePcm(const ldacdec_t* dec, SampleFormat format, uint8_t* out)
+        {
+            const int samples = dec->frame.frameSamples;
+            const int channels = dec->frame.channelCount;
+            uint8_t* p = out;
+            for (int i = 0; i < samples; ++i) {
+                for (int ch = 0; ch < channels; ++ch) {
+                    float v = dec->frame.channels[ch].pcm[i] * kDecoderPcmScale;
+                    if (format == SampleFormat::F32) {
+                        std::memcpy(p, &v, sizeof(v));
+                        p += sizeof(v);
+                        continue;
+                    }
+                    v = std::clamp(v, -1.0f, 1.0f);
+                    if (format == SampleFormat::S24) {
+                        int32_t s = (int32_t)std::lrint(std::min(v * 8388608.0, 8388607.0));
+                        p[0] = (uint8_t)s;
+                        p[1] = (uint8_t)(s >> 8);
+                        p[2] = (uint8_t)(s >> 16);
+                        p += 3;
+                    } else {
+                        int32_t s = (int32_t)std::lrint(std::min(v * 2147483648.0, 2147483647.0));
+                        std::memcpy(p, &s, sizeof(s));
+                        p += sizeof(s);
+                    }
+                }
+            }
+            return (size_t)(p - out);
+        }
+
+        // Channel-major planes -> interleaved frames, and back
+        template <size_t N>
+        void InterleaveSamples(const uint8_t* planar, size_t frames, int channels, uint8_t* out)
+        {
+            const size_t planeBytes = frames * N;
+            for (size_t i = 0; i < frames; ++i) {
+                for (int ch = 0; ch < channels; ++ch) {
+                    std::memcpy(out, planar + ch * planeBytes + i * N, N);
+                    out += N;
+                }
+            }
+        }
+
+        template <size_t N>
+        void DeinterleaveSamples(const uint8_t* in, size_t frames, int channels, uint8_t* planar)
+        {
+            const size_t planeBytes = frames * N;
+            for (size_t i = 0; i < frames; ++i) {
+                for (int ch = 0; ch < channels; ++ch) {
+                    std::memcpy(planar + ch * planeBytes + i * N, in, N);
+                    in += N;
+                }
+            }
+        }
+
+        void Interleave(const uint8_t* planar, size_t frames, int channels, size_t sampleBytes, uint8_t* out)
+        {
+            if (sampleBytes == 2) InterleaveSamples<2>(planar, frames, channels, out);
+            else if (sampleBytes == 3) InterleaveSamples<3>(planar, frames, channels, out);
+            else InterleaveSamples<4>(planar, frames, channels, out);
+        }
+
+        void Deinterleave(const uint8_t* in, size_t frames, int channels, size_t sampleBytes, uint8_t* planar)
+        {
+            if (sampleBytes == 2) DeinterleaveSamples<2>(in, frames, channels, planar);
+            else if (sampleBytes == 3) DeinterleaveSamples<3>(in, frames, channels, planar);
+            else DeinterleaveSamples<4>(in, frames, channels, planar);
+        }
+
+        // ldacBT's stereo bitrate (kbps) for a quality level: 990 / 660 / 330 at 48 / 96 kHz,
+        // 909 / 606 / 303 at 44.1 / 88.2 kHz
+        int LdacQualityBitrate(int eqmid, int sampleRate)
+        {
+            const int kbps = eqmid == LDACBT_EQMID_HQ ? 990 : eqmid == LDACBT_EQMID_SQ ? 660 : 330;
+            return sampleRate % 44100 == 0 ? kbps * 909 / 990 : kbps;
+        }
+    }
+
     // Auto-registration
     namespace {
+
         const bool registered = []() {
             AudioCodecFactory::Instance().Register("ldac", []() -> std::unique_ptr<IAudioCodec> {
                 return std::make_unique<LdacCodec>();
@@ -31,180 +121,1138 @@ namespace CodecTest
         Reset();
     }
 
-    bool LdacCodec::Initialize(int sampleRate, int channels, int bitsPerSample)
+    bool LdacCodec::Initialize(const AudioFormat& audioFormat, const EncoderOptions& options)
     {
         Reset();
 
+        const int sampleRate = audioFormat.sampleRate;
+        const int channels = audioFormat.channels;
+        const SampleFormat format = audioFormat.sampleFormat;
         m_sampleRate = sampleRate;
         m_channels = channels;
-        m_bitsPerSample = bitsPerSample;
-
-        m_hLdac = ldacBT_get_handle();
-        if (!m_hLdac) return false;
+        m_bitsPerSample = SampleFormatBytes(format) * 8;
+        m_pcmFormat = format;
+        m_pcmSampleRate = sampleRate;
+        m_pcmChannels = channels;
+        m_pcmInterleaved = audioFormat.interleaved;
+        // Decode hands back PCM in the same format
+        m_decoder.format = format;
 
         // Configure LDAC
-        int mtu = 990; // High Quality / Max MTU
-        int eqmid = LDACBT_EQMID_HQ; // Force High Quality
+        m_mtu = options.mtu > 0 ? options.mtu : kLdacDefaultMtu;
+        switch (options.quality) {
+        case EncodeQuality::High: m_eqmid = LDACBT_EQMID_HQ; break;
+        case EncodeQuality::Standard: m_eqmid = LDACBT_EQMID_SQ; break;
+        case EncodeQuality::Mobile: m_eqmid = LDACBT_EQMID_MQ; break;
+        default: return false;
+        }
+        m_maxEqmid = m_eqmid;
+        m_adaptive = options.adaptive;
         
-        int cm = LDACBT_CHANNEL_MODE_STEREO;
-        if (channels == 1) cm = LDACBT_CHANNEL_MODE_MONO;
-        else if (channels == 2) cm = LDACBT_CHANNEL_MODE_STEREO;
-        else {
-             // Fallback or error? defaulting to stereo for now
-             cm = LDACBT_CHANNEL_MODE_STEREO;
+        if (channels < 1 || channels > kLdacMaxMuxChannels) return false;
+        // Above two channels, the first pair's handle is m_hLdac and the rest get their own
+        int cm = (channels == 1) ? LDACBT_CHANNEL_MODE_MONO : LDACBT_CHANNEL_MODE_STEREO;
+        m_channelMode = cm;
+
+        m_hLdac = OpenEncoder(cm);
+        if (!m_hLdac) return false;
+
+        if (channels > 2) {
+            const size_t sampleBytes = (size_t)SampleFormatBytes(format);
+            m_muxPairs.resize((size_t)(channels + 1) / 2);
+            for (size_t p = 0; p < m_muxPairs.size(); ++p) {
+                MuxPair& pair = m_muxPairs[p];
+                pair.firstChannel = (int)p * 2;
+                pair.channels = std::min(2, channels - pair.firstChannel);
+                pair.handle = (p == 0) ? m_hLdac
+                    : OpenEncoder(pair.channels == 1 ? LDACBT_CHANNEL_MODE_MONO : LDACBT_CHANNEL_MODE_STEREO);
+                if (!pair.handle) return false;
+                pair.block.resize(LDACBT_ENC_LSU * pair.channels * sampleBytes);
+            }
+        }
+
+        // LDAC expects fixed 128 samples per channel
+        m_blockBytes = (size_t)LDACBT_ENC_LSU * channels * SampleFormatBytes(format);
+        m_pending.reserve(m_blockBytes);
+        return true;
+    }
+
+    void* LdacCodec::OpenEncoder(int channelMode) const
+    {
+        HANDLE_LDAC_BT h = ldacBT_get_handle();
+        if (!h) return nullptr;
+        if (!InitEncoder(h, channelMode)) {
+            ldacBT_free_handle(h);
+            return nullptr;
         }
+        return h;
+    }
 
+    bool LdacCodec::InitEncoder(void* hLdac, int channelMode) const
+    {
         LDACBT_SMPL_FMT_T fmt = LDACBT_SMPL_FMT_S16;
-        if (bitsPerSample == 16) fmt = LDACBT_SMPL_FMT_S16;
-        else if (bitsPerSample == 24) fmt = LDACBT_SMPL_FMT_S24;
-        else if (bitsPerSample == 32) fmt = LDACBT_SMPL_FMT_S32;
-        else if (bitsPerSample == 32) fmt = LDACBT_SMPL_FMT_F32; // Assuming float if 32-bit (needs context, but usually PCM is int)
-        // Note: For simplicity assuming integer PCM for 32-bit here unless float is explicit. 
-        // Standard Windows audio might be float, but let's assume S32 for now.
-        
-        int ret = ldacBT_init_handle_encode((HANDLE_LDAC_BT)m_hLdac, mtu, eqmid, cm, fmt, sampleRate);
-        return (ret == 0);
+        switch (m_pcmFormat) {
+        case SampleFormat::S16: fmt = LDACBT_SMPL_FMT_S16; break;
+        case SampleFormat::S24: fmt = LDACBT_SMPL_FMT_S24; break;
+        case SampleFormat::S32: fmt = LDACBT_SMPL_FMT_S32; break;
+        case SampleFormat::F32: fmt = LDACBT_SMPL_FMT_F32; break;
+        }
+
+        return ldacBT_init_handle_encode((HANDLE_LDAC_BT)hLdac, m_mtu, m_eqmid, channelMode, fmt, m_pcmSampleRate) == 0;
     }
 
-    std::vector<uint8_t> LdacCodec::Encode(const void* pcmData, size_t pcmBytes)
+    AudioFormat LdacCodec::GetAudioFormat() const
     {
-        if (!m_hLdac) return {};
+        AudioFormat format;
+        format.sampleRate = m_sampleRate;
+        format.channels = m_channels;
+        format.sampleFormat = m_pcmFormat;
+        format.interleaved = m_pcmInterleaved;
+        return format;
+    }
 
-        std::vector<uint8_t> outBuffer;
-        
-        // LDAC expects fixed 128 samples per channel
-        int bytesPerSample = m_bitsPerSample / 8;
-        int frameSize = 128 * m_channels * bytesPerSample; 
-        
-        const uint8_t* src = static_cast<const uint8_t*>(pcmData);
-        size_t processed = 0;
+    bool LdacCodec::InterleaveInput(const void*& pcmData, size_t pcmBytes)
+    {
+        if (m_pcmInterleaved || m_pcmChannels <= 1 || !pcmData) return true;
 
-        unsigned char streamBuf[LDACBT_MAX_NBYTES]; 
+        const size_t sampleBytes = (size_t)SampleFormatBytes(m_pcmFormat);
+        const size_t frameBytes = sampleBytes * m_pcmChannels;
+        if (pcmBytes % frameBytes != 0) return false;
 
-        while (processed < pcmBytes)
-        {
-            // Prepare 128-sample block
-            std::vector<uint8_t> inputBlock(frameSize, 0); // Zero init for padding
-            size_t remain = pcmBytes - processed;
-            size_t copySize = (remain < (size_t)frameSize) ? remain : (size_t)frameSize;
-            
-            std::memcpy(inputBlock.data(), src + processed, copySize);
+        m_interleaved.resize(pcmBytes);
+        Interleave(static_cast<const uint8_t*>(pcmData), pcmBytes / frameBytes, m_pcmChannels, sampleBytes, m_interleaved.data());
+        pcmData = m_interleaved.data();
+        return true;
+    }
+
+    template <typename Sink>
+    bool LdacCodec::EncodeBlock(void* hLdac, const uint8_t* block, unsigned char* streamBuf, Sink& sink)
+    {
+        int pcm_used = 0;
+        int stream_sz = 0;
+        int frame_num = 0;
+
+        // ldacBT_encode only reads the PCM, so full blocks go straight from the source
+        int ret = ldacBT_encode((HANDLE_LDAC_BT)hLdac,
+                                const_cast<uint8_t*>(block),
+                                &pcm_used,
+                                streamBuf,
+                                &stream_sz,
+                                &frame_num);
+
+        if (ret != 0) {
+            // Encoding error (fatal or non-fatal)
+            // ldacBT_get_error_code(hLdac) could be used.
+            return false;
+        }
+        return stream_sz <= 0 || sink(streamBuf, (size_t)stream_sz);
+    }
 
+    template <typename Sink>
+    bool LdacCodec::DrainEncoder(void* hLdac, unsigned char* streamBuf, Sink& sink)
+    {
+        // A null PCM pointer asks ldacBT to encode what is left in its delay line and release
+        // the packet it is holding; repeat until it has nothing more
+        for (size_t call = 0; call <= kLdacFlushFrames; ++call) {
             int pcm_used = 0;
             int stream_sz = 0;
             int frame_num = 0;
+            if (ldacBT_encode((HANDLE_LDAC_BT)hLdac, nullptr, &pcm_used, streamBuf, &stream_sz, &frame_num) != 0) return false;
+            if (stream_sz <= 0) return true;
+            if (!sink(streamBuf, (size_t)stream_sz)) return false;
+        }
+        return true;
+    }
 
-            int ret = ldacBT_encode((HANDLE_LDAC_BT)m_hLdac, 
-                                    inputBlock.data(), 
-                                    &pcm_used, 
-                                    streamBuf, 
-                                    &stream_sz, 
-                                    &frame_num);
-            
-            if (ret != 0) {
-                // Encoding error (fatal or non-fatal)
-                // We might want to handle it, but for now just stop or continue?
-                // ldacBT_get_error_code(m_hLdac) could be used.
-                // If we stop here, we return what we have.
-                break;
+    template <typename Sink>
+    bool LdacCodec::FinishStream(Sink& sink)
+    {
+        unsigned char streamBuf[LDACBT_MAX_NBYTES];
+        bool ok = true;
+        if (m_muxPairs.empty()) {
+            ok = DrainEncoder(m_hLdac, streamBuf, sink);
+        } else {
+            // Every pair has encoded the same blocks, so once drained the groups all complete
+            for (MuxPair& pair : m_muxPairs) {
+                auto enqueue = [&](const uint8_t* data, size_t bytes) {
+                    pair.queue.insert(pair.queue.end(), data, data + bytes);
+                    return true;
+                };
+                ok = DrainEncoder(pair.handle, streamBuf, enqueue) && ok;
             }
+            ok = ok && EmitMuxGroups(sink);
+        }
+        // A drained handle has ended its stream: the next call starts a new one
+        EndStream();
+        return ok;
+    }
+
+    void LdacCodec::EndStream()
+    {
+        for (MuxPair& pair : m_muxPairs) {
+            pair.queue.clear();
+            pair.readPos = 0;
+        }
+        m_muxGroup.clear();
+        m_pending.clear();
+        // Restarting costs ldaclib a free and a reallocation, so it waits until the handles
+        // are fed again: a flush on an ended stream or a Recycle right after one skips it.
+        // Handles that were never fed are still at the start of a stream and need none.
+        m_needsRestart = m_needsRestart || m_streamActive;
+        m_streamActive = false;
+    }
+
+    bool LdacCodec::RestartEncoders()
+    {
+        // The handles themselves are kept; ldacBT_close_handle releases only the encoder
+        // state that ldacBT_init_handle_encode allocates again
+        bool ok = true;
+        if (m_muxPairs.empty()) {
+            ldacBT_close_handle((HANDLE_LDAC_BT)m_hLdac);
+            ok = InitEncoder(m_hLdac, m_channelMode);
+        }
+        for (MuxPair& pair : m_muxPairs) {
+            ldacBT_close_handle((HANDLE_LDAC_BT)pair.handle);
+            ok = InitEncoder(pair.handle, pair.channels == 1 ? LDACBT_CHANNEL_MODE_MONO : LDACBT_CHANNEL_MODE_STEREO) && ok;
+            pair.queue.clear();
+            pair.readPos = 0;
+        }
+        m_muxGroup.clear();
+        m_pending.clear();
+        m_streamActive = false;
+        m_needsRestart = !ok;
+        return ok;
+    }
+
+    template <typename Sink>
+    bool LdacCodec::EncodeBlocks(const void* pcmData, size_t pcmBytes, bool flush, Sink&& sink)
+    {
+        if (!m_hLdac || m_blockBytes == 0) return false;
+
+        // One stream buffer per call, not per block
+        unsigned char streamBuf[LDACBT_MAX_NBYTES];
 
-            if (stream_sz > 0) {
-                outBuffer.insert(outBuffer.end(), streamBuf, streamBuf + stream_sz);
+        // Multichannel streams fan each run of blocks out to the pair handles
+        auto encodeRun = [&](const uint8_t* blocks, size_t count) {
+            m_streamActive = true;
+            if (!m_muxPairs.empty()) return EncodeMuxRun(blocks, count, sink);
+            for (size_t i = 0; i < count; ++i) {
+                if (!EncodeBlock(m_hLdac, blocks + i * m_blockBytes, streamBuf, sink)) return false;
             }
-            
+            return true;
+        };
+
+        const uint8_t* src = static_cast<const uint8_t*>(pcmData);
+        size_t processed = 0;
+        if (!src) pcmBytes = 0;
+
+        if (m_needsRestart) {
+            // Nothing has been fed since the stream ended, so a flush has nothing to emit
+            if (pcmBytes == 0) return true;
+            if (!RestartEncoders()) return false;
+        }
+
+        // Complete the block carried over from the previous call first
+        if (!m_pending.empty() && pcmBytes > 0)
+        {
+            size_t need = m_blockBytes - m_pending.size();
+            size_t copySize = (pcmBytes < need) ? pcmBytes : need;
+            m_pending.insert(m_pending.end(), src, src + copySize);
             processed += copySize;
+
+            if (m_pending.size() == m_blockBytes)
+            {
+                bool ok = encodeRun(m_pending.data(), 1);
+                m_pending.clear();
+                if (!ok) {
+                    // A failed flush still ends the stream, so nothing stale leaks into the next one
+                    if (flush) EndStream();
+                    return false;
+                }
+            }
+        }
+
+        // LDAC expects fixed 128 samples per channel
+        size_t fullBlocks = (pcmBytes - processed) / m_blockBytes;
+        if (fullBlocks > 0)
+        {
+            if (!encodeRun(src + processed, fullBlocks)) {
+                // If we stop here, the caller keeps what has been written.
+                if (flush) EndStream();
+                return false;
+            }
+            processed += fullBlocks * m_blockBytes;
+        }
+
+        // Only the final partial block is staged
+        m_pending.insert(m_pending.end(), src + processed, src + pcmBytes);
+
+        if (flush)
+        {
+            bool ok = true;
+            if (!m_pending.empty()) {
+                // Zero padding for the last partial block
+                m_pending.resize(m_blockBytes, 0);
+                ok = encodeRun(m_pending.data(), 1);
+                m_pending.clear();
+            }
+            if (!ok) {
+                EndStream();
+                return false;
+            }
+            // ldacBT only releases full packets: drain the frames it is still holding
+            return FinishStream(sink);
+        }
+        return true;
+    }
+
+    template <typename Sink>
+    bool LdacCodec::EncodeMuxRun(const uint8_t* blocks, size_t count, Sink& sink)
+    {
+        const size_t sampleBytes = (size_t)SampleFormatBytes(m_pcmFormat);
+        const size_t frameBytes = sampleBytes * m_pcmChannels;
+
+        auto encodePair = [&](MuxPair& pair) {
+            unsigned char streamBuf[LDACBT_MAX_NBYTES];
+            auto enqueue = [&](const uint8_t* data, size_t bytes) {
+                pair.queue.insert(pair.queue.end(), data, data + bytes);
+                return true;
+            };
+            const size_t pairBytes = sampleBytes * pair.channels;
+            for (size_t b = 0; b < count; ++b) {
+                // Pull this pair's channels out of the interleaved block
+                const uint8_t* src = blocks + b * m_blockBytes + pair.firstChannel * sampleBytes;
+                uint8_t* dst = pair.block.data();
+                for (size_t i = 0; i < LDACBT_ENC_LSU; ++i, src += frameBytes, dst += pairBytes) {
+                    std::memcpy(dst, src, pairBytes);
+                }
+                if (!EncodeBlock(pair.handle, pair.block.data(), streamBuf, enqueue)) return false;
+            }
+            return true;
+        };
+
+        bool ok = true;
+        if (m_parallelism != 1 && count >= kLdacMinFramesPerSegment) {
+            // The pair handles are independent, so long runs get a task per pair
+            std::vector<char> results(m_muxPairs.size(), 0);
+            TaskGroup group(WorkerPool::Shared());
+            for (size_t p = 1; p < m_muxPairs.size(); ++p) {
+                group.Run([&, p]() { results[p] = encodePair(m_muxPairs[p]); });
+            }
+            results[0] = encodePair(m_muxPairs[0]);
+            group.Wait();
+            for (char result : results) ok = ok && result;
+        } else {
+            for (MuxPair& pair : m_muxPairs) ok = encodePair(pair) && ok;
+        }
+        return EmitMuxGroups(sink) && ok;
+    }
+
+    template <typename Sink>
+    bool LdacCodec::EmitMuxGroups(Sink& sink)
+    {
+        // ldacBT releases frames a packet at a time, and mono / stereo packets fill at different
+        // rates, so a group goes out only once every pair has its frame for that period
+        bool ok = true;
+        while (ok) {
+            LdacFrameHeader headers[kLdacMaxMuxPairs];
+            size_t groupBytes = kLdacMuxHeaderBytes;
+            for (size_t p = 0; p < m_muxPairs.size() && groupBytes > 0; ++p) {
+                const MuxPair& pair = m_muxPairs[p];
+                if (!LdacParseHeader(pair.queue.data() + pair.readPos, pair.queue.size() - pair.readPos, headers[p])) groupBytes = 0;
+                else groupBytes += headers[p].FrameBytes();
+            }
+            if (groupBytes == 0) break;
+
+            m_muxGroup.resize(groupBytes);
+            LdacWriteMuxHeader(m_muxGroup.data(), m_pcmChannels);
+            size_t pos = kLdacMuxHeaderBytes;
+            for (size_t p = 0; p < m_muxPairs.size(); ++p) {
+                MuxPair& pair = m_muxPairs[p];
+                size_t bytes = headers[p].FrameBytes();
+                std::memcpy(m_muxGroup.data() + pos, pair.queue.data() + pair.readPos, bytes);
+                pair.readPos += bytes;
+                pos += bytes;
+            }
+            ok = sink(m_muxGroup.data(), groupBytes);
+        }
+
+        for (MuxPair& pair : m_muxPairs) {
+            pair.queue.erase(pair.queue.begin(), pair.queue.begin() + pair.readPos);
+            pair.readPos = 0;
+        }
+        return ok;
+    }
+
+    template <typename Sink>
+    bool LdacCodec::EncodeParallel(const uint8_t* src, size_t pcmBytes, Sink&& sink)
+    {
+        // Multichannel streams already spread across pair handles. A stream in progress holds
+        // frames (and MDCT overlap) on m_hLdac that this call has to continue, so it stays serial.
+        if (!src || !m_hLdac || m_blockBytes == 0 || m_streamActive || !m_pending.empty() || !m_muxPairs.empty()) return false;
+
+        // Segments start on frame boundaries: a frame spans two 128-sample blocks above 48 kHz
+        const size_t blocksPerFrame = m_pcmSampleRate > 48000 ? 2 : 1;
+        const size_t frames = pcmBytes / m_blockBytes / blocksPerFrame;
+        size_t threads = ThreadBudget();
+        size_t segments = std::min(threads, frames / kLdacMinFramesPerSegment);
+        if (segments < 2) return false;
+
+        const size_t frameBytes = m_blockBytes * blocksPerFrame;
+        struct Segment
+        {
+            size_t firstFrame{ 0 };
+            size_t frameCount{ 0 };  // frames kept; 0 means everything after the priming (last segment)
+            std::vector<uint8_t> stream;
+            bool ok{ false };
+        };
+        std::vector<Segment> work(segments);
+        size_t perSegment = frames / segments;
+        for (size_t i = 0; i < segments; ++i)
+        {
+            work[i].firstFrame = i * perSegment;
+            work[i].frameCount = (i + 1 == segments) ? 0 : perSegment;
+        }
+
+        auto encodeSegment = [&](Segment& seg) {
+            void* h = OpenEncoder(m_channelMode);
+            if (!h) return;
+
+            // Encode a few frames on either side of the segment so the overlap at its edges
+            // matches the serial encode, and end it with a real flush like the serial path
+            size_t priming = std::min(seg.firstFrame, kLdacEncodeOverlapFrames);
+            const uint8_t* begin = src + (seg.firstFrame - priming) * frameBytes;
+            const uint8_t* end = src + pcmBytes;
+            if (seg.frameCount > 0) {
+                size_t lastFrame = std::min(frames, seg.firstFrame + seg.frameCount + kLdacEncodeOverlapFrames);
+                end = src + lastFrame * frameBytes;
+            }
+
+            size_t skip = priming;
+            size_t keep = seg.frameCount;
+            bool full = false;
+            auto keepFrames = [&](const uint8_t* data, size_t bytes) {
+                // ldacBT emits whole frames, so the output can be walked header by header
+                size_t pos = 0;
+                while (pos < bytes && !full) {
+                    LdacFrameHeader header;
+                    if (!LdacParseHeader(data + pos, bytes - pos, header)) return false;
+                    if (skip > 0) {
+                        skip--;
+                    } else {
+                        seg.stream.insert(seg.stream.end(), data + pos, data + pos + header.FrameBytes());
+                        if (keep > 0 && --keep == 0) full = true;
+                    }
+                    pos += header.FrameBytes();
+                }
+                return true;
+            };
+
+            unsigned char streamBuf[LDACBT_MAX_NBYTES];
+            bool ok = true;
+            const uint8_t* block = begin;
+            for (; ok && !full && (size_t)(end - block) >= m_blockBytes; block += m_blockBytes) {
+                ok = EncodeBlock(h, block, streamBuf, keepFrames);
+            }
+            if (ok && !full && block < end) {
+                // Zero padding for the last partial block, as in the serial path
+                std::vector<uint8_t> last(m_blockBytes, 0);
+                std::memcpy(last.data(), block, (size_t)(end - block));
+                ok = EncodeBlock(h, last.data(), streamBuf, keepFrames);
+            }
+            // Whatever the handle still holds: the final frames of the stream for the last
+            // segment, frames past the kept range (dropped) for the others
+            if (ok && !full) ok = DrainEncoder(h, streamBuf, keepFrames);
+            ldacBT_free_handle((HANDLE_LDAC_BT)h);
+            seg.ok = ok && (seg.frameCount == 0 || full);
+        };
+
+        TaskGroup group(WorkerPool::Shared());
+        for (size_t i = 1; i < segments; ++i) group.Run([&, i]() { encodeSegment(work[i]); });
+        encodeSegment(work[0]);
+        group.Wait();
+
+        // A segment that came up short would leave a gap: let the caller encode serially
+        for (const Segment& seg : work) {
+            if (!seg.ok) return false;
+        }
+        for (const Segment& seg : work) {
+            if (!seg.stream.empty() && !sink(seg.stream.data(), seg.stream.size())) return false;
+        }
+        return true;
+    }
+
+    size_t LdacCodec::MaxEncodedBytes(size_t pcmBytes) const
+    {
+        if (m_blockBytes == 0) return 0;
+        // At most one frame per 128-sample block; +1 block for the carried-over
+        // remainder, +1 for flush padding and the frames draining ldacBT's delay line
+        // yields at the end of a stream. ldacBT may also release frames it held back
+        // from earlier calls, which is bounded by one packet (MTU).
+        // Multichannel: one frame per pair plus a group header, and a packet held per pair.
+        size_t blocks = pcmBytes / m_blockBytes + 2 + kLdacFlushFrames;
+        if (!m_muxPairs.empty()) {
+            size_t pairs = m_muxPairs.size();
+            return blocks * (pairs * kLdacMaxFrameBytes + kLdacMuxHeaderBytes) + pairs * (size_t)m_mtu;
+        }
+        return blocks * kLdacMaxFrameBytes + (size_t)m_mtu;
+    }
+
+    size_t LdacCodec::EstimateEncodedBytes(size_t pcmBytes, bool flush) const
+    {
+        if (m_blockBytes == 0 || !m_hLdac) return 0;
+        size_t total = m_pending.size() + pcmBytes;
+        size_t blocks = total / m_blockBytes;
+        if (flush && total % m_blockBytes) blocks++;
+
+        // Average stream bytes per 128-sample block at the current bitrate, plus one
+        // packet of slack because ldacBT emits whole packets
+        int kbps = GetBitrate();
+        if (kbps <= 0 || m_pcmSampleRate <= 0) return MaxEncodedBytes(pcmBytes);
+        size_t perBlock = ((size_t)kbps * 1000 * LDACBT_ENC_LSU / m_pcmSampleRate + 7) / 8;
+        if (!m_muxPairs.empty()) perBlock += kLdacMuxHeaderBytes;
+        return blocks * perBlock + (size_t)m_mtu;
+    }
+
+    int LdacCodec::GetBitrate() const
+    {
+        if (!m_hLdac) return 0;
+        // ldacBT reports kbps; a multichannel stream carries every pair's
+        int kbps = ldacBT_get_bitrate((HANDLE_LDAC_BT)m_hLdac);
+        for (size_t p = 1; p < m_muxPairs.size(); ++p) kbps += ldacBT_get_bitrate((HANDLE_LDAC_BT)m_muxPairs[p].handle);
+        return kbps > 0 ? kbps : 0;
+    }
+
+    size_t LdacCodec::ThreadBudget() const
+    {
+        // Segments run as tasks on the library's shared pool; 0 follows its size
+        return m_parallelism > 0 ? (size_t)m_parallelism : WorkerPool::Shared()->ThreadCount();
+    }
+
+    CodecCapabilities LdacCodec::GetCapabilities() const
+    {
+        CodecCapabilities caps;
+        caps.blockSamples = LDACBT_ENC_LSU;
+        if (!m_hLdac) {
+            caps.sampleRates = { 44100, 48000, 88200, 96000 };
+            caps.sampleFormats = { SampleFormat::S16, SampleFormat::S24, SampleFormat::S32, SampleFormat::F32 };
+            caps.maxChannels = kLdacMaxMuxChannels;
+            caps.frameSamples = (int)kLdacMaxFrameSamples;
+            caps.delaySamples = (int)kLdacMaxFrameSamples;
+            caps.maxFrameBytes = kLdacMuxHeaderBytes + kLdacMaxMuxPairs * kLdacMaxFrameBytes;
+            caps.maxBitrate = LdacQualityBitrate(LDACBT_EQMID_HQ, 48000) * (int)kLdacMaxMuxPairs;
+            caps.mtu = kLdacDefaultMtu;
+            return caps;
+        }
+
+        // One frame per block up to 48 kHz, two above; the MDCT overlap delays output by a frame
+        const size_t pairs = m_muxPairs.empty() ? 1 : m_muxPairs.size();
+        caps.sampleRates = { m_pcmSampleRate };
+        caps.sampleFormats = { m_pcmFormat };
+        caps.maxChannels = m_pcmChannels;
+        caps.frameSamples = m_pcmSampleRate > 48000 ? 2 * LDACBT_ENC_LSU : LDACBT_ENC_LSU;
+        caps.delaySamples = caps.frameSamples;
+        caps.maxFrameBytes = pairs * kLdacMaxFrameBytes + (m_muxPairs.empty() ? 0 : kLdacMuxHeaderBytes);
+        // The adaptive controller never goes above the configured quality
+        caps.maxBitrate = LdacQualityBitrate(m_maxEqmid, m_pcmSampleRate) * (int)pairs;
+        caps.mtu = m_mtu;
+        return caps;
+    }
+
+    bool LdacCodec::AlterQuality(int priority)
+    {
+        if (ldacBT_alter_eqmid_priority((HANDLE_LDAC_BT)m_hLdac, priority) != 0) return false;
+        // Pairs stay on the same level as the first one
+        for (size_t p = 1; p < m_muxPairs.size(); ++p) ldacBT_alter_eqmid_priority((HANDLE_LDAC_BT)m_muxPairs[p].handle, priority);
+        return true;
+    }
+
+    void LdacCodec::ReportLinkBudget(int kbps)
+    {
+        if (!m_adaptive || !m_hLdac || kbps <= 0) return;
+
+        int current = GetBitrate();
+        if (current <= 0) return;
+        const int usable = (int)((int64_t)kbps * kLdacLinkHeadroomPercent / 100);
+
+        // The HQ / SQ / MQ rates stand 3 : 2 : 1 at any sampling rate
+        const int unit = current / (LDACBT_EQMID_MQ + 1 - m_eqmid);
+
+        if (current > usable) {
+            // Over budget: drop straight to the highest level that fits (MQ if none does)
+            m_upgradeReports = 0;
+            while (m_eqmid < LDACBT_EQMID_MQ && unit * (LDACBT_EQMID_MQ + 1 - m_eqmid) > usable) {
+                if (!AlterQuality(LDACBT_EQMID_INC_CONNECTION)) break;
+                m_eqmid++;
+            }
+            return;
         }
 
+        // Step up one level at a time, and only once the room has been there for a while
+        if (m_eqmid > m_maxEqmid && unit * (LDACBT_EQMID_MQ + 2 - m_eqmid) <= usable) {
+            if (++m_upgradeReports >= kLdacUpgradeReports) {
+                m_upgradeReports = 0;
+                if (AlterQuality(LDACBT_EQMID_INC_QUALITY)) m_eqmid--;
+            }
+        } else {
+            m_upgradeReports = 0;
+        }
+    }
+
+    size_t LdacCodec::MaxDecodedBytes(size_t codedBytes) const
+    {
+        size_t frames = codedBytes / kLdacMinFrameBytes + 1;
+        return frames * kLdacMaxFrameSamples * kLdacMaxChannels * DecodedSampleBytes();
+    }
+
+    std::vector<uint8_t> LdacCodec::Encode(const void* pcmData, size_t pcmBytes)
+    {
+        // One-shot encode is a stream that ends with this call
+        std::vector<uint8_t> outBuffer;
+        if (!InterleaveInput(pcmData, pcmBytes)) return outBuffer;
+        outBuffer.reserve(EstimateEncodedBytes(pcmBytes, true));
+        auto append = [&](const uint8_t* data, size_t bytes) {
+            outBuffer.insert(outBuffer.end(), data, data + bytes);
+            return true;
+        };
+        if (m_parallelism != 1 && EncodeParallel(static_cast<const uint8_t*>(pcmData), pcmBytes, append)) return outBuffer;
+
+        outBuffer.clear();
+        EncodeBlocks(pcmData, pcmBytes, true, append);
         return outBuffer;
     }
 
-    std::vector<uint8_t> LdacCodec::Decode(const void* codedData, size_t codedBytes)
+    std::vector<uint8_t> LdacCodec::EncodeStream(const void* pcmData, size_t pcmBytes)
     {
-        if (!codedData || codedBytes == 0) return {};
+        std::vector<uint8_t> outBuffer;
+        if (!InterleaveInput(pcmData, pcmBytes)) return outBuffer;
+        outBuffer.reserve(EstimateEncodedBytes(pcmBytes, false));
+        EncodeBlocks(pcmData, pcmBytes, false, [&](const uint8_t* data, size_t bytes) {
+            outBuffer.insert(outBuffer.end(), data, data + bytes);
+            return true;
+        });
+        return outBuffer;
+    }
+
+    std::vector<uint8_t> LdacCodec::FlushStream()
+    {
+        return Encode(nullptr, 0);
+    }
+
+    bool LdacCodec::EncodeInto(const void* pcmData, size_t pcmBytes, std::span<uint8_t> out, size_t& written)
+    {
+        written = 0;
+        if (!InterleaveInput(pcmData, pcmBytes)) return false;
+        auto copyOut = [&](const uint8_t* data, size_t bytes) {
+            // Never overrun the caller's span, even if the size query was too small
+            if (bytes > out.size() - written) return false;
+            std::memcpy(out.data() + written, data, bytes);
+            written += bytes;
+            return true;
+        };
+        if (m_parallelism != 1 && EncodeParallel(static_cast<const uint8_t*>(pcmData), pcmBytes, copyOut)) return true;
 
-        if (!m_hDec) {
-             m_hDec = new ldacdec_t;
-             ldacdecInit((ldacdec_t*)m_hDec);
+        written = 0;
+        return EncodeBlocks(pcmData, pcmBytes, true, copyOut);
+    }
+
+    bool LdacCodec::EncodeStreamInto(const void* pcmData, size_t pcmBytes, std::span<uint8_t> out, size_t& written)
+    {
+        written = 0;
+        if (!InterleaveInput(pcmData, pcmBytes)) return false;
+        return EncodeBlocks(pcmData, pcmBytes, false, [&](const uint8_t* data, size_t bytes) {
+            if (bytes > out.size() - written) return false;
+            std::memcpy(out.data() + written, data, bytes);
+            written += bytes;
+            return true;
+        });
+    }
+
+    bool LdacCodec::FlushStreamInto(std::span<uint8_t> out, size_t& written)
+    {
+        return EncodeInto(nullptr, 0, out, written);
+    }
+
+    void LdacCodec::InitDecoder(DecoderState& state)
+    {
+        if (!state.dec) state.dec = new ldacdec_t;
+        ldacdecInit((ldacdec_t*)state.dec);
+        for (void* dec : state.pairDecs) ldacdecInit((ldacdec_t*)dec);
+        state.hasLastHeader = false;
+        state.muxChannels = 0;
+    }
+
+    void LdacCodec::FreeDecoder(DecoderState& state)
+    {
+        delete (ldacdec_t*)state.dec;
+        state.dec = nullptr;
+        for (void* dec : state.pairDecs) delete (ldacdec_t*)dec;
+        state.pairDecs.clear();
+        state.hasLastHeader = false;
+        state.muxChannels = 0;
+    }
+
+    bool LdacCodec::DecodeMuxGroup(DecoderState& state, const uint8_t* group, const LdacMuxGroup& info, uint8_t* out, size_t& outBytes)
+    {
+        while (state.pairDecs.size() + 1 < info.pairs) {
+            ldacdec_t* dec = new ldacdec_t;
+            ldacdecInit(dec);
+            state.pairDecs.push_back(dec);
         }
-        
-        ldacdec_t* dec = (ldacdec_t*)m_hDec;
-        std::vector<uint8_t> pcmOut;
-        
-        // Reserve some space to avoid reallocs (approximate ratio)
-        pcmOut.reserve(codedBytes * 10); 
+
+        const size_t sampleBytes = (size_t)SampleFormatBytes(state.format);
+        int16_t tempPcm[kLdacMaxFrameSamples * kLdacMaxChannels];
+        alignas(4) uint8_t pairPcm[kLdacMaxFrameSamples * kLdacMaxChannels * 4];
+
+        size_t pos = kLdacMuxHeaderBytes;
+        size_t samples = 0;
+        for (size_t p = 0; p < info.pairs; ++p) {
+            ldacdec_t* dec = (ldacdec_t*)(p == 0 ? state.dec : state.pairDecs[p - 1]);
+            int bytesUsed = 0;
+            if (ldacDecode(dec, (uint8_t*)(group + pos), tempPcm, &bytesUsed) < 0 || bytesUsed <= 0) return false;
+            pos += info.frames[p].FrameBytes();
+
+            const uint8_t* pcm = reinterpret_cast<const uint8_t*>(tempPcm);
+            if (state.format != SampleFormat::S16) {
+                ConvertFramePcm(dec, state.format, pairPcm);
+                pcm = pairPcm;
+            }
+
+            // Place the pair's channels into the full interleaved frame
+            const size_t pairBytes = (size_t)dec->frame.channelCount * sampleBytes;
+            const size_t frameBytes = (size_t)info.channels * sampleBytes;
+            samples = (size_t)dec->frame.frameSamples;
+            uint8_t* dst = out + p * 2 * sampleBytes;
+            for (size_t i = 0; i < samples; ++i, pcm += pairBytes, dst += frameBytes) {
+                std::memcpy(dst, pcm, pairBytes);
+            }
+        }
+        outBytes = samples * info.channels * sampleBytes;
+        return true;
+    }
+
+    template <typename Sink>
+    bool LdacCodec::DecodeFrames(DecoderState& state, const void* codedData, size_t codedBytes, Sink&& sink)
+    {
+        if (!codedData || codedBytes == 0) return false;
+
+        if (!state.dec) InitDecoder(state);
+        ldacdec_t* dec = (ldacdec_t*)state.dec;
 
         const uint8_t* src = static_cast<const uint8_t*>(codedData);
         size_t processed = 0;
         
-        // Output buffer for one frame (2ch * 256 samples * 2 bytes = 1024 bytes)
-        // libldacdec outputs int16_t[256 * 2] (interleaved?) -> verify implementation
-        // ldacDecode takes int16_t *pcm. 
-        // Inside ldacDecode: pcmFloatToShort writes to pcmOut.
-        // It writes `frameSamples` * `channelCount` samples.
-        // Max frame samples 256. Max channels 2. So 512 samples -> 1024 bytes.
-        int16_t tempPcm[256 * 2]; 
+        // ldacDecode always fills an int16 buffer; other output formats are taken from the
+        // decoder's float PCM (dec->frame.channels[].pcm) instead, without going through it
+        int16_t tempPcm[kLdacMaxFrameSamples * kLdacMaxChannels];
+        alignas(4) uint8_t framePcm[kLdacMaxFrameSamples * kLdacMaxMuxChannels * 4];
+
+        bool lostSync = false;
 
         while (processed < codedBytes)
         {
-            // Sync word check (0xAA) - ldacDecode does this, but we should probably 
-            // search for it if we are not aligned. 
-            // For now assume aligned or let ldacDecode fail.
-            
-            if (src[processed] != 0xAA) {
-                 // Skip until sync word found
-                 processed++;
-                 continue;
+            // Jump to the next candidate sync byte
+            size_t sync = LdacFindSync(src, codedBytes, processed);
+            if (sync != processed) {
+                state.stats.bytesSkipped += sync - processed;
+                lostSync = true;
+                processed = sync;
+                if (processed >= codedBytes) break;
+            }
+
+            const LdacFrameHeader* locked = state.hasLastHeader ? &state.lastHeader : nullptr;
+
+            // Multichannel group: every pair frame is decoded, or the group is skipped as a whole
+            LdacMuxGroup group;
+            if (LdacCheckMuxGroup(src + processed, codedBytes - processed, locked, state.muxChannels, group)) {
+                size_t bytes = 0;
+                bool decoded = DecodeMuxGroup(state, src + processed, group, framePcm, bytes);
+                // A group that passed the header checks is consumed whole even if it fails to
+                // decode, exactly as LdacBuildFrameIndex walks it, so the output never holds
+                // frames the index (and the output sizing built on it) did not count
+                state.lastHeader = group.frames[0];
+                state.hasLastHeader = true;
+                state.muxChannels = group.channels;
+                processed += group.bytes;
+                if (!decoded) {
+                    state.stats.bytesSkipped += group.bytes;
+                    lostSync = true;
+                    continue;
+                }
+                if (lostSync) {
+                    state.stats.resyncs++;
+                    lostSync = false;
+                }
+                state.stats.framesDecoded++;
+                if (!sink(framePcm, bytes)) return false;
+                continue;
             }
 
-            // Check if enough data for minimal header? 
-            if (processed + 2 > codedBytes) break;
+            // Cheap plausibility check before running the full decoder on a candidate.
+            // Inside a multichannel stream, a lone frame is a pair frame of a damaged group.
+            LdacFrameHeader header;
+            if (state.muxChannels > 0 || !LdacCheckFrame(src + processed, codedBytes - processed, state.hasLastHeader ? &state.lastHeader : nullptr, header)) {
+                // False sync word, or a truncated frame at the end
+                state.stats.bytesSkipped++;
+                lostSync = true;
+                processed++;
+                continue;
+            }
 
             int bytesUsed = 0;
             int ret = ldacDecode(dec, (uint8_t*)(src + processed), tempPcm, &bytesUsed);
-            
-            if (ret < 0) {
-                // Decode failed, maybe false sync word
-                processed++; 
+
+            // Resume at the next indexed offset whatever the outcome, as for groups above
+            state.lastHeader = header;
+            state.hasLastHeader = true;
+            if (ret < 0 || bytesUsed <= 0) {
+                // Damaged payload behind a plausible header
+                state.stats.bytesSkipped += header.FrameBytes();
+                lostSync = true;
+                processed += header.FrameBytes();
                 continue;
             }
-            
-            if (bytesUsed <= 0) {
-                 // Should not happen on success
-                 processed++;
-                 continue;
-            }
 
-            // Update format info from decoder state
-            m_sampleRate = ldacdecGetSampleRate(dec);
-            m_channels = ldacdecGetChannelCount(dec);
-            m_bitsPerSample = 16; // libldacdec always outputs 16-bit PCM
+            if (lostSync) {
+                state.stats.resyncs++;
+                lostSync = false;
+            }
+            state.stats.framesDecoded++;
 
             int samplesProduced = dec->frame.frameSamples; // samples per channel
             int channels = dec->frame.channelCount;
             int totalSamples = samplesProduced * channels;
             
-            const uint8_t* pcmBytes = reinterpret_cast<const uint8_t*>(tempPcm);
-            pcmOut.insert(pcmOut.end(), pcmBytes, pcmBytes + totalSamples * sizeof(int16_t));
+            if (state.format == SampleFormat::S16) {
+                const uint8_t* pcmBytes = reinterpret_cast<const uint8_t*>(tempPcm);
+                if (!sink(pcmBytes, totalSamples * sizeof(int16_t))) return false;
+            } else {
+                size_t bytes = ConvertFramePcm(dec, state.format, framePcm);
+                if (!sink(framePcm, bytes)) return false;
+            }
+
+            processed += header.FrameBytes();
+        }
+
+        return true;
+    }
+
+    void LdacCodec::UpdateDecodedFormat(const DecoderState& state)
+    {
+        // Update format info from the last decoded frame
+        if (!state.hasLastHeader) return;
+        m_sampleRate = state.lastHeader.SampleRate();
+        m_channels = state.muxChannels > 0 ? state.muxChannels : state.lastHeader.Channels();
+        m_bitsPerSample = SampleFormatBytes(state.format) * 8;
+    }
+
+    std::vector<uint8_t> LdacCodec::Decode(const void* codedData, size_t codedBytes)
+    {
+        std::vector<uint8_t> pcmOut;
+        if (!codedData || codedBytes == 0) return pcmOut;
 
-            processed += bytesUsed;
+        // Exact output size from a header-only scan
+        pcmOut.resize(DecodedBytes(codedData, codedBytes));
+
+        size_t written = 0;
+        DecodeInto(codedData, codedBytes, pcmOut, written);
+        pcmOut.resize(written);
+        return pcmOut;
+    }
+
+    template <typename DecodeFn>
+    bool LdacCodec::DecodePlanarInto(std::span<uint8_t> out, size_t& written, DecodeFn&& decode)
+    {
+        written = 0;
+        m_interleaved.resize(out.size());
+        bool ok = decode(std::span<uint8_t>(m_interleaved), written);
+
+        // Channel count of what was just decoded
+        const size_t sampleBytes = DecodedSampleBytes();
+        const int channels = std::max(m_channels, 1);
+        Deinterleave(m_interleaved.data(), written / (sampleBytes * channels), channels, sampleBytes, out.data());
+        return ok;
+    }
+
+    bool LdacCodec::DecodeInto(const void* codedData, size_t codedBytes, std::span<uint8_t> out, size_t& written)
+    {
+        if (m_pcmInterleaved) return DecodeInterleavedInto(codedData, codedBytes, out, written);
+        return DecodePlanarInto(out, written, [&](std::span<uint8_t> interleaved, size_t& n) {
+            return DecodeInterleavedInto(codedData, codedBytes, interleaved, n);
+        });
+    }
+
+    bool LdacCodec::DecodeInterleavedInto(const void* codedData, size_t codedBytes, std::span<uint8_t> out, size_t& written)
+    {
+        written = 0;
+        if (!codedData || codedBytes == 0) return false;
+
+        size_t resume = 0;
+        if (m_parallelism != 1 && DecodeParallel(static_cast<const uint8_t*>(codedData), codedBytes, out, written, resume)) {
+            return true;
         }
+        if (resume >= codedBytes) {
+            UpdateDecodedFormat(m_decoder);
+            return true;
+        }
+
+        bool ok = DecodeFrames(m_decoder, static_cast<const uint8_t*>(codedData) + resume, codedBytes - resume, [&](const uint8_t* pcm, size_t bytes) {
+            // Caller's span is full: stop rather than overrun
+            if (bytes > out.size() - written) return false;
+            std::memcpy(out.data() + written, pcm, bytes);
+            written += bytes;
+            return true;
+        });
+        UpdateDecodedFormat(m_decoder);
+        return ok;
+    }
+
+    bool LdacCodec::DecodeParallel(const uint8_t* src, size_t codedBytes, std::span<uint8_t> out, size_t& written, size_t& resumeOffset)
+    {
+        // Walk the input from the decoder's current lock, exactly as the serial path and
+        // DecodedBytes do, so both accept the same frames
+        FrameIndex index;
+        const LdacFrameHeader* lock = m_decoder.hasLastHeader ? &m_decoder.lastHeader : nullptr;
+        if (!LdacBuildFrameIndex(src, codedBytes, index, lock, m_decoder.muxChannels)) return false;
+
+        // Not worth the threads for short streams
+        size_t threads = ThreadBudget();
+        size_t segments = std::min(threads, index.frames.size() / kLdacMinFramesPerSegment);
+        if (segments < 2) return false;
+
+        const int sampleBytes = (int)DecodedSampleBytes();
+        size_t total = (size_t)index.PcmBytes((int)DecodedSampleBytes());
+        if (total > out.size()) return false;
+
+        struct Segment
+        {
+            DecoderState state;
+            size_t firstFrame{ 0 };
+            size_t lastFrame{ 0 };
+            size_t expected{ 0 };
+            size_t produced{ 0 };
+            bool ok{ false };
+        };
+        std::vector<Segment> work(segments);
+        size_t perSegment = index.frames.size() / segments;
+        for (size_t i = 0; i < segments; ++i)
+        {
+            work[i].firstFrame = i * perSegment;
+            work[i].lastFrame = (i + 1 == segments) ? index.frames.size() : (i + 1) * perSegment;
+        }
+
+        // The first segment continues on the caller's decoder from the start of the input, so a
+        // stream split across calls keeps its lock and MDCT overlap exactly as the serial path
+        // would; its stats are taken from the index below like the others
+        const DecodeStats savedStats = m_decoder.stats;
+        auto decodeFirstSegment = [&](Segment& seg) {
+            const FrameIndexEntry& end = index.frames[seg.lastFrame - 1];
+            seg.expected = (size_t)index.PcmBytes(0, seg.lastFrame, sampleBytes);
+            seg.ok = DecodeFrames(m_decoder, src, (size_t)(end.offset + end.bytes), [&](const uint8_t* pcm, size_t bytes) {
+                if (bytes > seg.expected - seg.produced) return false;
+                std::memcpy(out.data() + seg.produced, pcm, bytes);
+                seg.produced += bytes;
+                return true;
+            });
+        };
+
+        auto decodeSegment = [&](Segment& seg) {
+            // Each segment warms up its own decoder on the frames before it, then
+            // writes straight to its slot in the output
+            size_t startFrame = seg.firstFrame >= kLdacPrerollFrames ? seg.firstFrame - kLdacPrerollFrames : 0;
+            size_t preroll = seg.firstFrame - startFrame;
+            const FrameIndexEntry& begin = index.frames[startFrame];
+            const FrameIndexEntry& end = index.frames[seg.lastFrame - 1];
+            size_t outOffset = (size_t)index.frames[seg.firstFrame].pcmPosition * sampleBytes;
+            seg.expected = (size_t)index.PcmBytes(seg.firstFrame, seg.lastFrame, sampleBytes);
 
+            seg.state.format = m_decoder.format;
+            InitDecoder(seg.state);
+            seg.ok = DecodeFrames(seg.state, src + begin.offset, (size_t)(end.offset + end.bytes - begin.offset), [&](const uint8_t* pcm, size_t bytes) {
+                if (preroll > 0) {
+                    preroll--;
+                    return true;
+                }
+                if (bytes > seg.expected - seg.produced) return false;
+                std::memcpy(out.data() + outOffset + seg.produced, pcm, bytes);
+                seg.produced += bytes;
+                return true;
+            });
+            FreeDecoder(seg.state);
+        };
+
+        TaskGroup group(WorkerPool::Shared());
+        for (size_t i = 1; i < segments; ++i) group.Run([&, i]() { decodeSegment(work[i]); });
+        decodeFirstSegment(work[0]);
+        group.Wait();
+
+        // A segment that dropped or failed frames would leave a gap. The caller's decoder has
+        // gone through the first segment exactly as a serial decode would, so the caller
+        // carries on serially from the end of it.
+        bool allOk = true;
+        for (const Segment& seg : work) allOk = allOk && seg.ok && seg.produced == seg.expected;
+        if (!allOk) {
+            if (work[0].ok) {
+                const FrameIndexEntry& end = index.frames[work[0].lastFrame - 1];
+                resumeOffset = (size_t)(end.offset + end.bytes);
+                written = work[0].produced;
+            } else {
+                // Only if the decoder outran the index: start over from a clean decoder
+                ResetDecoder();
+                m_decoder.stats = savedStats;
+            }
+            return false;
+        }
+        m_decoder.stats = savedStats;
+
+        // Segments overlap by the preroll frames, so take the stats from the index instead
+        uint64_t expectedOffset = 0;
+        for (const FrameIndexEntry& frame : index.frames) {
+            if (frame.offset != expectedOffset) {
+                m_decoder.stats.bytesSkipped += frame.offset - expectedOffset;
+                m_decoder.stats.resyncs++;
+            }
+            expectedOffset = frame.offset + frame.bytes;
+        }
+        m_decoder.stats.bytesSkipped += codedBytes - expectedOffset;
+        m_decoder.stats.framesDecoded += index.frames.size();
+
+        // Leave the serial decoder primed on the tail so a following call continues seamlessly
+        InitDecoder(m_decoder);
+        size_t tailFrame = index.frames.size() > kLdacPrerollFrames ? index.frames.size() - kLdacPrerollFrames : 0;
+        DecodeStats saved = m_decoder.stats;
+        DecodeFrames(m_decoder, src + index.frames[tailFrame].offset, codedBytes - (size_t)index.frames[tailFrame].offset,
+                     [](const uint8_t*, size_t) { return true; });
+        m_decoder.stats = saved;
+        UpdateDecodedFormat(m_decoder);
+
+        written = total;
+        return true;
+    }
+
+    size_t LdacCodec::DecodedBytes(const void* codedData, size_t codedBytes) const
+    {
+        // Walk the input from the decoder's current lock, as DecodeInto will
+        FrameIndex index;
+        const LdacFrameHeader* lock = m_decoder.hasLastHeader ? &m_decoder.lastHeader : nullptr;
+        if (!LdacBuildFrameIndex(static_cast<const uint8_t*>(codedData), codedBytes, index, lock, m_decoder.muxChannels)) return 0;
+        return (size_t)index.PcmBytes((int)DecodedSampleBytes());
+    }
+
+    bool LdacCodec::BuildFrameIndex(const void* codedData, size_t codedBytes, FrameIndex& index) const
+    {
+        return LdacBuildFrameIndex(static_cast<const uint8_t*>(codedData), codedBytes, index);
+    }
+
+    std::vector<uint8_t> LdacCodec::DecodeRange(const void* codedData, size_t codedBytes, const FrameIndex& index, size_t firstFrame, size_t frameCount)
+    {
+        std::vector<uint8_t> pcmOut;
+        if (firstFrame >= index.frames.size()) return pcmOut;
+
+        size_t lastFrame = std::min(index.frames.size(), firstFrame + frameCount);
+        pcmOut.resize((size_t)index.PcmBytes(firstFrame, lastFrame, (int)DecodedSampleBytes()));
+
+        size_t written = 0;
+        DecodeRangeInto(codedData, codedBytes, index, firstFrame, frameCount, pcmOut, written);
+        pcmOut.resize(written);
         return pcmOut;
     }
 
+    bool LdacCodec::DecodeRangeInto(const void* codedData, size_t codedBytes, const FrameIndex& index, size_t firstFrame, size_t frameCount, std::span<uint8_t> out, size_t& written)
+    {
+        if (m_pcmInterleaved) return DecodeRangeInterleavedInto(codedData, codedBytes, index, firstFrame, frameCount, out, written);
+        return DecodePlanarInto(out, written, [&](std::span<uint8_t> interleaved, size_t& n) {
+            return DecodeRangeInterleavedInto(codedData, codedBytes, index, firstFrame, frameCount, interleaved, n);
+        });
+    }
+
+    bool LdacCodec::DecodeRangeInterleavedInto(const void* codedData, size_t codedBytes, const FrameIndex& index, size_t firstFrame, size_t frameCount, std::span<uint8_t> out, size_t& written)
+    {
+        written = 0;
+        if (!codedData || firstFrame >= index.frames.size() || frameCount == 0) return false;
+
+        size_t lastFrame = std::min(index.frames.size(), firstFrame + frameCount);
+        size_t startFrame = firstFrame >= kLdacPrerollFrames ? firstFrame - kLdacPrerollFrames : 0;
+        const FrameIndexEntry& begin = index.frames[startFrame];
+        const FrameIndexEntry& end = index.frames[lastFrame - 1];
+        if (end.offset + end.bytes > codedBytes) return false;
+
+        // Start from a clean decoder; the preroll frames rebuild the overlap state
+        ResetDecoder();
+
+        const uint8_t* src = static_cast<const uint8_t*>(codedData);
+        size_t preroll = firstFrame - startFrame;
+        bool ok = DecodeFrames(m_decoder, src + begin.offset, (size_t)(end.offset + end.bytes - begin.offset), [&](const uint8_t* pcm, size_t bytes) {
+            if (preroll > 0) {
+                preroll--;
+                return true;
+            }
+            if (bytes > out.size() - written) return false;
+            std::memcpy(out.data() + written, pcm, bytes);
+            written += bytes;
+            return true;
+        });
+        UpdateDecodedFormat(m_decoder);
+        return ok;
+    }
+
+    void LdacCodec::ResetDecoder()
+    {
+        if (m_decoder.dec) InitDecoder(m_decoder);
+        m_decoder.hasLastHeader = false;
+    }
+
+    bool LdacCodec::Recycle()
+    {
+        if (!m_hLdac) return false;
+
+        // Back to the configured quality. The stream is only ended here: handles that were fed
+        // are restarted by the next encode, and clean ones (a decode-only user) never are.
+        m_eqmid = m_maxEqmid;
+        m_upgradeReports = 0;
+        EndStream();
+
+        if (m_decoder.dec) InitDecoder(m_decoder);
+        m_decoder.stats = {};
+        m_sampleRate = m_pcmSampleRate;
+        m_channels = m_pcmChannels;
+        m_bitsPerSample = SampleFormatBytes(m_pcmFormat) * 8;
+        m_parallelism = 1;
+        return true;
+    }
+
     void LdacCodec::Reset()
     {
+        // Pair 0 shares m_hLdac; the other pairs own their handles
+        for (size_t p = 1; p < m_muxPairs.size(); ++p) {
+            if (m_muxPairs[p].handle) ldacBT_free_handle((HANDLE_LDAC_BT)m_muxPairs[p].handle);
+        }
+        m_muxPairs.clear();
+        m_muxGroup.clear();
         if (m_hLdac) {
             ldacBT_free_handle((HANDLE_LDAC_BT)m_hLdac);
             m_hLdac = nullptr;
         }
-        if (m_hDec) {
-            delete (ldacdec_t*)m_hDec;
-            m_hDec = nullptr;
-        }
+        FreeDecoder(m_decoder);
         m_sampleRate = 0;
         m_channels = 0;
         m_bitsPerSample = 0;
+        m_blockBytes = 0;
+        m_mtu = 0;
+        m_eqmid = 0;
+        m_adaptive = false;
+        m_maxEqmid = 0;
+        m_upgradeReports = 0;
+        m_channelMode = 0;
+        m_pcmFormat = SampleFormat::S16;
+        m_pcmSampleRate = 0;
+        m_pcmChannels = 0;
+        m_pcmInterleaved = true;
+        m_interleaved.clear();
+        m_decoder.format = SampleFormat::S16;
+        m_pending.clear();
+        m_streamActive = false;
+        m_needsRestart = false;
+        m_decoder.stats = {};
     }
 }
\ No newline at end of file
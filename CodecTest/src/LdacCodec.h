@@ -1,5 +1,6 @@
 #pragma once
 #include "../include/IAudioCodec.h"
+#include "LdacFrame.h"
 
 namespace CodecTest
 {
@@ -9,22 +10,157 @@ namespace CodecTest
         LdacCodec();
         ~LdacCodec() override;
 
-        bool Initialize(int sampleRate, int channels, int bitsPerSample) override;
+        using IAudioCodec::Initialize;
+        bool Initialize(const AudioFormat& format, const EncoderOptions& options) override;
         std::vector<uint8_t> Encode(const void* pcmData, size_t pcmBytes) override;
+        std::vector<uint8_t> EncodeStream(const void* pcmData, size_t pcmBytes) override;
+        std::vector<uint8_t> FlushStream() override;
         std::vector<uint8_t> Decode(const void* codedData, size_t codedBytes) override;
+        bool EncodeInto(const void* pcmData, size_t pcmBytes, std::span<uint8_t> out, size_t& written) override;
+        bool EncodeStreamInto(const void* pcmData, size_t pcmBytes, std::span<uint8_t> out, size_t& written) override;
+        bool FlushStreamInto(std::span<uint8_t> out, size_t& written) override;
+        bool DecodeInto(const void* codedData, size_t codedBytes, std::span<uint8_t> out, size_t& written) override;
+        size_t MaxEncodedBytes(size_t pcmBytes) const override;
+        size_t MaxDecodedBytes(size_t codedBytes) const override;
+        size_t DecodedBytes(const void* codedData, size_t codedBytes) const override;
+        bool BuildFrameIndex(const void* codedData, size_t codedBytes, FrameIndex& index) const override;
+        std::vector<uint8_t> DecodeRange(const void* codedData, size_t codedBytes, const FrameIndex& index, size_t firstFrame, size_t frameCount) override;
+        bool DecodeRangeInto(const void* codedData, size_t codedBytes, const FrameIndex& index, size_t firstFrame, size_t frameCount, std::span<uint8_t> out, size_t& written) override;
+        DecodeStats GetDecodeStats() const override { return m_decoder.stats; }
+        void ReportLinkBudget(int kbps) override;
+        int GetBitrate() const override;
+        CodecCapabilities GetCapabilities() const override;
+        void SetParallelism(int threads) override { m_parallelism = threads; }
         void GetFormat(int& sampleRate, int& channels, int& bitsPerSample) const override {
             sampleRate = m_sampleRate;
             channels = m_channels;
             bitsPerSample = m_bitsPerSample;
         }
+        AudioFormat GetAudioFormat() const override;
+        bool Recycle() override;
         void Reset() override;
         std::string Name() const override { return "ldac"; }
 
     private:
+        // Encodes pcmData in 128-sample blocks, carrying a partial block over in m_pending
+        // (or zero-padding it when flush is set). Each produced stream chunk goes to
+        // sink(ptr, bytes); stops early when sink returns false.
+        template <typename Sink>
+        bool EncodeBlocks(const void* pcmData, size_t pcmBytes, bool flush, Sink&& sink);
+        template <typename Sink>
+        static bool EncodeBlock(void* hLdac, const uint8_t* block, unsigned char* streamBuf, Sink& sink);
+        // End of stream: emits every frame ldacBT is still holding on the handle
+        template <typename Sink>
+        static bool DrainEncoder(void* hLdac, unsigned char* streamBuf, Sink& sink);
+        // Drains every encoder handle (completing the last multichannel groups) and ends the
+        // stream; the handles are restarted when the next stream feeds them a block
+        template <typename Sink>
+        bool FinishStream(Sink& sink);
+        // Drops carried-over PCM and queued frames and marks the handles for a restart
+        void EndStream();
+        // Closes and re-initializes the encoder handles. ldacBT has no reset, so this frees
+        // and reallocates the encoder state inside ldaclib.
+        bool RestartEncoders();
+        // Multichannel: encodes count interleaved blocks on every pair handle (one thread per
+        // pair for long runs), then emits the groups that are complete
+        template <typename Sink>
+        bool EncodeMuxRun(const uint8_t* blocks, size_t count, Sink& sink);
+        template <typename Sink>
+        bool EmitMuxGroups(Sink& sink);
+        // New encoder handle with the settings chosen at Initialize
+        void* OpenEncoder(int channelMode) const;
+        // (Re)initializes an allocated handle for encoding with those settings
+        bool InitEncoder(void* hLdac, int channelMode) const;
+        // Steps every encoder handle by one quality level
+        bool AlterQuality(int priority);
+        // One-shot encode split into segments on separate handles; false if not applicable
+        // (short input, stream in progress, or a segment failed), in which case nothing reached sink.
+        // Each segment is flushed like the serial path, so the output matches the serial encode.
+        // The streaming handle is left untouched.
+        template <typename Sink>
+        bool EncodeParallel(const uint8_t* src, size_t pcmBytes, Sink&& sink);
+        // Planar input is interleaved into m_interleaved first (ldacBT only takes interleaved PCM).
+        // Fails when the buffer is not a whole number of sample frames.
+        bool InterleaveInput(const void*& pcmData, size_t pcmBytes);
+        // Expected stream size for the next call at the current bitrate (for vector presizing)
+        size_t EstimateEncodedBytes(size_t pcmBytes, bool flush) const;
+
+        // One libldacdec instance with its sync bookkeeping
+        struct DecoderState
+        {
+            void* dec{ nullptr }; // ldacdec_t*
+            DecodeStats stats{};
+            LdacFrameHeader lastHeader{};
+            bool hasLastHeader{ false };
+            SampleFormat format{ SampleFormat::S16 }; // output PCM
+            std::vector<void*> pairDecs;  // ldacdec_t* for pairs 1.. of a multichannel stream
+            int muxChannels{ 0 };         // locked onto a multichannel stream
+        };
+
+        // Decodes every frame found in codedData and hands each frame's PCM to sink(ptr, bytes).
+        // Stops early when sink returns false.
+        template <typename Sink>
+        static bool DecodeFrames(DecoderState& state, const void* codedData, size_t codedBytes, Sink&& sink);
+        // Decodes every pair frame of a group into out as interleaved PCM of all channels
+        static bool DecodeMuxGroup(DecoderState& state, const uint8_t* group, const LdacMuxGroup& info, uint8_t* out, size_t& outBytes);
+        static void InitDecoder(DecoderState& state);
+        static void FreeDecoder(DecoderState& state);
+        // Fresh decoder state for random access
+        void ResetDecoder();
+        void UpdateDecodedFormat(const DecoderState& state);
+        size_t DecodedSampleBytes() const { return (size_t)SampleFormatBytes(m_decoder.format); }
+        bool DecodeInterleavedInto(const void* codedData, size_t codedBytes, std::span<uint8_t> out, size_t& written);
+        bool DecodeRangeInterleavedInto(const void* codedData, size_t codedBytes, const FrameIndex& index, size_t firstFrame, size_t frameCount, std::span<uint8_t> out, size_t& written);
+        // Runs decode(span, written) into m_planar, then splits the result into channel planes in out
+        template <typename DecodeFn>
+        bool DecodePlanarInto(std::span<uint8_t> out, size_t& written, DecodeFn&& decode);
+        // Number of segments a one-shot call may be split into (m_parallelism, or the shared pool's size)
+        size_t ThreadBudget() const;
+        // Splits the stream into segments decoded on separate decoders; false if not applicable.
+        // The first segment runs on m_decoder, so a stream continued from an earlier call decodes
+        // as it would serially. If a later segment fails, returns false with written and
+        // resumeOffset set to where the serial path should carry on (both 0 to start over).
+        bool DecodeParallel(const uint8_t* src, size_t codedBytes, std::span<uint8_t> out, size_t& written, size_t& resumeOffset);
+
         void* m_hLdac{ nullptr }; // HANDLE_LDAC_BT
-        void* m_hDec{ nullptr };  // ldacdec_t*
         int m_sampleRate{ 0 };
         int m_channels{ 0 };
         int m_bitsPerSample{ 0 };
+        int m_mtu{ 0 };
+        int m_eqmid{ 0 };            // current quality; follows the adaptive controller
+
+        // Adaptive bitrate: quality is never raised above m_maxEqmid's level
+        bool m_adaptive{ false };
+        int m_maxEqmid{ 0 };
+        int m_upgradeReports{ 0 };   // consecutive reports with room for the next level
+        int m_channelMode{ 0 };
+        SampleFormat m_pcmFormat{ SampleFormat::S16 };
+        int m_pcmSampleRate{ 0 };    // as given at Initialize (m_sampleRate follows the decoded stream)
+        int m_pcmChannels{ 0 };
+        bool m_pcmInterleaved{ true };
+        std::vector<uint8_t> m_interleaved; // planar <-> interleaved scratch
+
+        // Streaming encode state: bytes of an incomplete block carried over to the next call
+        size_t m_blockBytes{ 0 };
+        std::vector<uint8_t> m_pending;
+        bool m_streamActive{ false };  // blocks have been fed to the handles since they were (re)started
+        bool m_needsRestart{ false };  // the handles ended a stream (drained or failed) and are re-initialized before the next block
+
+        // Multichannel (> 2ch) encode: one ldacBT handle per channel pair, frames queued per
+        // pair until every pair has its frame for the period
+        struct MuxPair
+        {
+            void* handle{ nullptr };      // HANDLE_LDAC_BT; pair 0 is m_hLdac and not owned here
+            int firstChannel{ 0 };
+            int channels{ 0 };
+            std::vector<uint8_t> block;   // this pair's samples of one 128-sample block
+            std::vector<uint8_t> queue;
+            size_t readPos{ 0 };
+        };
+        std::vector<MuxPair> m_muxPairs;  // empty for mono / stereo
+        std::vector<uint8_t> m_muxGroup;
+
+        DecoderState m_decoder;
+        int m_parallelism{ 1 };
     };
 }
\ No newline at end of file
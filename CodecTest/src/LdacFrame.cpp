@@ -0,0 +1,189 @@
+#include "../pch.h"
+#include "LdacFrame.h"
+#include <cstring>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define LDAC_SYNC_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LDAC_SYNC_SSE2 1
+#endif
+
+namespace CodecTest
+{
+    namespace {
+        inline unsigned CountTrailingZeros(uint32_t mask) noexcept
+        {
+#if defined(_MSC_VER) && !defined(__clang__)
+            unsigned long index;
+            _BitScanForward(&index, mask);
+            return (unsigned)index;
+#else
+            return (unsigned)__builtin_ctz(mask);
+#endif
+        }
+    }
+
+    int LdacFrameHeader::SampleRate() const noexcept
+    {
+        static const int kRates[] = { 44100, 48000, 88200, 96000 };
+        return (sampleRateId >= 0 && sampleRateId < 4) ? kRates[sampleRateId] : 0;
+    }
+
+    size_t LdacFindSync(const uint8_t* data, size_t size, size_t pos) noexcept
+    {
+        if (pos >= size) return size;
+
+        // Frames are usually back to back, so check the current byte before vectorizing
+        if (data[pos] == kLdacSyncWord) return pos;
+
+#if defined(LDAC_SYNC_AVX2)
+        const __m256i sync = _mm256_set1_epi8((char)kLdacSyncWord);
+        while (size - pos >= 32)
+        {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+            uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, sync));
+            if (mask) return pos + CountTrailingZeros(mask);
+            pos += 32;
+        }
+#elif defined(LDAC_SYNC_SSE2)
+        const __m128i sync = _mm_set1_epi8((char)kLdacSyncWord);
+        while (size - pos >= 16)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+            uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, sync));
+            if (mask) return pos + CountTrailingZeros(mask);
+            pos += 16;
+        }
+#endif
+        const void* hit = std::memchr(data + pos, kLdacSyncWord, size - pos);
+        return hit ? (size_t)(static_cast<const uint8_t*>(hit) - data) : size;
+    }
+
+    bool LdacParseHeader(const uint8_t* p, size_t avail, LdacFrameHeader& out) noexcept
+    {
+        if (avail < kLdacHeaderBytes || p[0] != kLdacSyncWord) return false;
+
+        LdacFrameHeader h;
+        h.sampleRateId = p[1] >> 5;
+        h.channelConfigId = (p[1] >> 3) & 0x3;
+        h.frameLength = (((p[1] & 0x7) << 6) | (p[2] >> 2)) + 1;
+        h.frameStatus = p[2] & 0x3;
+
+        // libldacdec handles 44.1 / 48 / 88.2 / 96 kHz; channel config 3 is reserved
+        if (h.sampleRateId > 3 || h.channelConfigId == 3) return false;
+        if (h.FrameBytes() > avail) return false;
+
+        out = h;
+        return true;
+    }
+
+    void LdacWriteMuxHeader(uint8_t* p, int channels) noexcept
+    {
+        p[0] = kLdacSyncWord;
+        p[1] = (uint8_t)(0xE0 | channels);
+        p[2] = (uint8_t)~p[1];
+    }
+
+    bool LdacParseMuxGroup(const uint8_t* p, size_t avail, LdacMuxGroup& out) noexcept
+    {
+        if (avail < kLdacMuxHeaderBytes || p[0] != kLdacSyncWord) return false;
+        if ((p[1] & 0xE0) != 0xE0 || (uint8_t)~p[1] != p[2]) return false;
+
+        LdacMuxGroup g;
+        g.channels = p[1] & 0x1F;
+        if (g.channels <= 2 || g.channels > kLdacMaxMuxChannels) return false;
+        g.pairs = (size_t)(g.channels + 1) / 2;
+
+        size_t pos = kLdacMuxHeaderBytes;
+        for (size_t i = 0; i < g.pairs; ++i) {
+            LdacFrameHeader& h = g.frames[i];
+            if (!LdacParseHeader(p + pos, avail - pos, h)) return false;
+            if (h.Channels() != g.PairChannels(i)) return false;
+            if (i > 0 && h.sampleRateId != g.frames[0].sampleRateId) return false;
+            pos += h.FrameBytes();
+        }
+        g.bytes = pos;
+
+        out = g;
+        return true;
+    }
+
+    bool LdacCheckMuxGroup(const uint8_t* p, size_t avail, const LdacFrameHeader* locked, int lockedMuxChannels, LdacMuxGroup& out) noexcept
+    {
+        if (locked && lockedMuxChannels == 0) return false;
+        if (!LdacParseMuxGroup(p, avail, out)) return false;
+        return !locked || (out.channels == lockedMuxChannels && out.frames[0].SameFormat(*locked));
+    }
+
+    bool LdacCheckFrame(const uint8_t* p, size_t avail, const LdacFrameHeader* locked, LdacFrameHeader& out) noexcept
+    {
+        if (!LdacParseHeader(p, avail, out)) return false;
+
+        // Once locked, a frame with the same format is accepted as is
+        if (locked && out.SameFormat(*locked)) return true;
+
+        size_t next = out.FrameBytes();
+        return next == avail || p[next] == kLdacSyncWord;
+    }
+
+    bool LdacBuildFrameIndex(const uint8_t* data, size_t size, FrameIndex& index,
+                             const LdacFrameHeader* lock, int muxChannels)
+    {
+        index = {};
+        if (!data || size == 0) return false;
+        index.frames.reserve(size / kLdacMaxFrameBytes + 1);
+
+        LdacFrameHeader locked = lock ? *lock : LdacFrameHeader{};
+        bool hasLock = lock != nullptr;
+        // muxChannels > 0: locked onto a multichannel stream
+        size_t pos = 0;
+
+        while (pos < size)
+        {
+            pos = LdacFindSync(data, size, pos);
+            if (pos >= size) break;
+
+            FrameIndexEntry entry;
+            entry.offset = pos;
+            entry.samplePosition = index.totalSamples;
+            entry.pcmPosition = index.pcmSamples;
+
+            LdacMuxGroup group;
+            LdacFrameHeader header;
+            if (LdacCheckMuxGroup(data + pos, size - pos, hasLock ? &locked : nullptr, muxChannels, group)) {
+                header = group.frames[0];
+                muxChannels = group.channels;
+                entry.bytes = (uint32_t)group.bytes;
+            } else if (muxChannels == 0 && LdacCheckFrame(data + pos, size - pos, hasLock ? &locked : nullptr, header)) {
+                entry.bytes = (uint32_t)header.FrameBytes();
+            } else {
+                pos++;
+                continue;
+            }
+
+            // An unlocked stream may switch between mono and stereo, so the output size is
+            // summed per frame
+            entry.samples = (uint32_t)header.FrameSamples();
+            entry.channels = (uint32_t)(muxChannels > 0 ? muxChannels : header.Channels());
+            if (index.frames.empty()) {
+                index.sampleRate = header.SampleRate();
+                index.channels = (int)entry.channels;
+            }
+
+            index.frames.push_back(entry);
+            index.totalSamples += entry.samples;
+            index.pcmSamples += (uint64_t)entry.samples * entry.channels;
+
+            locked = header;
+            hasLock = true;
+            pos += entry.bytes;
+        }
+
+        return !index.frames.empty();
+    }
+}
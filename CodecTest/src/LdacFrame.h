@@ -0,0 +1,101 @@
+#pragma once
+#include "../include/IAudioCodec.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+namespace CodecTest
+{
+    // LDAC frame header: sync(8) + sampling rate(3) + channel config(2) + frame length - 1(9) + status(2)
+    constexpr uint8_t kLdacSyncWord = 0xAA;
+    constexpr size_t kLdacHeaderBytes = 3;
+    constexpr size_t kLdacMaxFrameBytes = kLdacHeaderBytes + 512;
+    constexpr size_t kLdacMaxFrameSamples = 256;
+    constexpr size_t kLdacMaxChannels = 2;
+    // Smallest frame the lowest ldacBT quality level produces, with margin.
+    // Only used for sizing; writers never go past the caller's span.
+    constexpr size_t kLdacMinFrameBytes = 48;
+    // Frames decoded and discarded before a seek target to rebuild the IMDCT overlap
+    // (one frame is needed; one more for margin)
+    constexpr size_t kLdacPrerollFrames = 2;
+    // Smallest segment handed to a worker in parallel decode
+    constexpr size_t kLdacMinFramesPerSegment = 64;
+    // Parallel encode: frames encoded and dropped on either side of each segment so the
+    // handle's overlap state at the segment edges matches the serial encode
+    constexpr size_t kLdacEncodeOverlapFrames = 4;
+    // Upper bound on the frames ldacBT produces from its delay line when drained at the end
+    // of a stream (on top of the partially filled packet it releases)
+    constexpr size_t kLdacFlushFrames = 4;
+
+    // Default packet size (the largest ldacBT accepts)
+    constexpr int kLdacDefaultMtu = 990;
+    // Adaptive bitrate: share of the reported link budget the stream may use, and how many
+    // consecutive reports must leave room for the next quality level before stepping up
+    constexpr int kLdacLinkHeadroomPercent = 90;
+    constexpr int kLdacUpgradeReports = 3;
+
+    struct LdacFrameHeader
+    {
+        int sampleRateId{ 0 };
+        int channelConfigId{ 0 };
+        int frameLength{ 0 };  // payload bytes following the header
+        int frameStatus{ 0 };
+
+        size_t FrameBytes() const noexcept { return kLdacHeaderBytes + (size_t)frameLength; }
+        int SampleRate() const noexcept;
+        int Channels() const noexcept { return channelConfigId == 0 ? 1 : 2; }
+        int FrameSamples() const noexcept { return sampleRateId < 2 ? 128 : 256; }
+        bool SameFormat(const LdacFrameHeader& other) const noexcept {
+            return sampleRateId == other.sampleRateId && channelConfigId == other.channelConfigId;
+        }
+    };
+
+    // Multichannel (> 2ch) streams are a sequence of groups, one per frame period: a 3-byte
+    // group header followed by one LDAC frame per channel pair (channels 0/1, 2/3, ...; the
+    // last pair is mono for odd counts). The header is the sync byte, then 0xE0 | channels and
+    // its complement. Sampling rate id 7 is invalid in a frame header, so plain LDAC parsers
+    // (and libldacdec) reject a group header instead of mistaking it for a frame.
+    constexpr size_t kLdacMuxHeaderBytes = 3;
+    constexpr int kLdacMaxMuxChannels = 8;
+    constexpr size_t kLdacMaxMuxPairs = (kLdacMaxMuxChannels + 1) / 2;
+
+    struct LdacMuxGroup
+    {
+        int channels{ 0 };
+        size_t pairs{ 0 };
+        size_t bytes{ 0 };   // header and all pair frames
+        LdacFrameHeader frames[kLdacMaxMuxPairs];
+
+        int FrameSamples() const noexcept { return frames[0].FrameSamples(); }
+        int PairChannels(size_t pair) const noexcept { return (int)std::min<size_t>(2, channels - pair * 2); }
+    };
+
+    void LdacWriteMuxHeader(uint8_t* p, int channels) noexcept;
+
+    // Parses a whole group at p: a valid header, and one frame per pair with a common sampling
+    // rate and the expected channel count. Fails when the group does not fit in avail.
+    bool LdacParseMuxGroup(const uint8_t* p, size_t avail, LdacMuxGroup& out) noexcept;
+
+    // Group acceptance for a sync candidate: groups are rejected once locked onto a plain
+    // stream (lockedMuxChannels == 0), and must match the locked channel count and format otherwise.
+    bool LdacCheckMuxGroup(const uint8_t* p, size_t avail, const LdacFrameHeader* locked, int lockedMuxChannels, LdacMuxGroup& out) noexcept;
+
+    // Returns the offset of the first sync byte at or after pos, or size if there is none.
+    // Uses AVX2 / SSE2 when the build enables them, scalar otherwise.
+    size_t LdacFindSync(const uint8_t* data, size_t size, size_t pos) noexcept;
+
+    // Parses the header at p. Fails when the fields are out of range (sampling rates
+    // above 96 kHz, channel config 3) or the whole frame does not fit in avail.
+    bool LdacParseHeader(const uint8_t* p, size_t avail, LdacFrameHeader& out) noexcept;
+
+    // Header sanity check for a sync candidate; rejects most false syncs without decoding.
+    // Accepts a frame matching the locked format (if any), otherwise requires the next
+    // frame to start right after it (or the data to end there).
+    bool LdacCheckFrame(const uint8_t* p, size_t avail, const LdacFrameHeader* locked, LdacFrameHeader& out) noexcept;
+
+    // Header-only scan producing the frame offset / sample position table.
+    // For multichannel streams each entry is a whole group. lock / muxChannels start the scan
+    // already locked onto a stream, as a decoder carrying state over from earlier input is.
+    bool LdacBuildFrameIndex(const uint8_t* data, size_t size, FrameIndex& index,
+                             const LdacFrameHeader* lock = nullptr, int muxChannels = 0);
+}
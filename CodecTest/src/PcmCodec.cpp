@@ -1,17 +1,20 @@
 #include "../pch.h"
 #include "PcmCodec.h"
 #include "AudioCodecFactory.h"
+#include "WorkerPool.h"
+#include <algorithm>
 #include <cstring>
 #include <cstdlib>
 
 // 単純にそのままコピーする PCM コーデック（エンコード=パススルー、デコード=パススルー）
 namespace CodecTest
 {
-    bool PcmCodec::Initialize(int sampleRate, int channels, int bitsPerSample)
+    bool PcmCodec::Initialize(const AudioFormat& format, const EncoderOptions&)
     {
-        m_sampleRate = sampleRate;
-        m_channels = channels;
-        m_bitsPerSample = bitsPerSample;
+        m_sampleRate = format.sampleRate;
+        m_channels = format.channels;
+        m_bitsPerSample = SampleFormatBytes(format.sampleFormat) * 8;
+        m_format = format;
         return true;
     }
 
@@ -25,6 +28,12 @@ namespace CodecTest
         return out;
     }
 
+    std::vector<uint8_t> PcmCodec::EncodeStream(const void* pcmData, size_t pcmBytes)
+    {
+        // フレーム単位の処理が無いため端数の持ち越しも無い
+        return Encode(pcmData, pcmBytes);
+    }
+
     std::vector<uint8_t> PcmCodec::Decode(const void* codedData, size_t codedBytes)
     {
         // そのままコピー
@@ -35,11 +44,81 @@ namespace CodecTest
         return out;
     }
 
+    bool PcmCodec::EncodeInto(const void* pcmData, size_t pcmBytes, std::span<uint8_t> out, size_t& written)
+    {
+        written = 0;
+        if (pcmData == nullptr || pcmBytes == 0) return true;
+        if (out.size() < pcmBytes) return false;
+        Copy(out.data(), pcmData, pcmBytes);
+        written = pcmBytes;
+        return true;
+    }
+
+    bool PcmCodec::DecodeInto(const void* codedData, size_t codedBytes, std::span<uint8_t> out, size_t& written)
+    {
+        written = 0;
+        if (codedData == nullptr || codedBytes == 0) return true;
+        if (out.size() < codedBytes) return false;
+        Copy(out.data(), codedData, codedBytes);
+        written = codedBytes;
+        return true;
+    }
+
+    void PcmCodec::Copy(uint8_t* dst, const void* src, size_t bytes) const
+    {
+        // 分割の単位。これより小さい区間はタスクにする利点が無い
+        constexpr size_t kMinChunkBytes = 1 << 20;
+        const uint8_t* s = static_cast<const uint8_t*>(src);
+        size_t threads = m_parallelism > 0 ? (size_t)m_parallelism : WorkerPool::Shared()->ThreadCount();
+        size_t chunks = std::min(threads, bytes / kMinChunkBytes);
+        if (m_parallelism == 1 || chunks < 2) {
+            std::memcpy(dst, s, bytes);
+            return;
+        }
+
+        size_t perChunk = bytes / chunks;
+        TaskGroup group(WorkerPool::Shared());
+        for (size_t i = 1; i < chunks; ++i) {
+            size_t begin = i * perChunk;
+            size_t size = (i + 1 == chunks) ? bytes - begin : perChunk;
+            group.Run([=]() { std::memcpy(dst + begin, s + begin, size); });
+        }
+        std::memcpy(dst, s, perChunk);
+        group.Wait();
+    }
+
+    CodecCapabilities PcmCodec::GetCapabilities() const
+    {
+        // フレーム構造も遅延も無く、任意のレート・チャンネル数をそのまま通す
+        CodecCapabilities caps;
+        caps.blockSamples = 1;
+        if (m_format.channels > 0) {
+            caps.sampleRates = { m_format.sampleRate };
+            caps.sampleFormats = { m_format.sampleFormat };
+            caps.maxChannels = m_format.channels;
+            caps.maxBitrate = (int)((int64_t)m_format.sampleRate * m_format.channels * SampleFormatBytes(m_format.sampleFormat) * 8 / 1000);
+        } else {
+            caps.sampleFormats = { SampleFormat::S16, SampleFormat::S24, SampleFormat::S32, SampleFormat::F32 };
+        }
+        return caps;
+    }
+
+    bool PcmCodec::Recycle()
+    {
+        if (m_format.channels <= 0) return false;
+        m_sampleRate = m_format.sampleRate;
+        m_channels = m_format.channels;
+        m_bitsPerSample = SampleFormatBytes(m_format.sampleFormat) * 8;
+        m_parallelism = 1;
+        return true;
+    }
+
     void PcmCodec::Reset()
     {
         m_sampleRate = 0;
         m_channels = 0;
         m_bitsPerSample = 0;
+        m_format = {};
     }
 
     // ライブラリ起動時に登録するための静的初期化子
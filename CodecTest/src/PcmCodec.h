@@ -11,14 +11,45 @@ namespace CodecTest
         PcmCodec() = default;
         ~PcmCodec() override = default;
 
-        bool Initialize(int sampleRate, int channels, int bitsPerSample) override;
+        using IAudioCodec::Initialize;
+        bool Initialize(const AudioFormat& format, const EncoderOptions& options) override;
         std::vector<uint8_t> Encode(const void* pcmData, size_t pcmBytes) override;
+        std::vector<uint8_t> EncodeStream(const void* pcmData, size_t pcmBytes) override;
+        std::vector<uint8_t> FlushStream() override { return {}; }
         std::vector<uint8_t> Decode(const void* codedData, size_t codedBytes) override;
+        bool EncodeInto(const void* pcmData, size_t pcmBytes, std::span<uint8_t> out, size_t& written) override;
+        bool EncodeStreamInto(const void* pcmData, size_t pcmBytes, std::span<uint8_t> out, size_t& written) override {
+            return EncodeInto(pcmData, pcmBytes, out, written);
+        }
+        bool FlushStreamInto(std::span<uint8_t>, size_t& written) override { written = 0; return true; }
+        bool DecodeInto(const void* codedData, size_t codedBytes, std::span<uint8_t> out, size_t& written) override;
+        size_t MaxEncodedBytes(size_t pcmBytes) const override { return pcmBytes; }
+        size_t MaxDecodedBytes(size_t codedBytes) const override { return codedBytes; }
+        size_t DecodedBytes(const void*, size_t codedBytes) const override { return codedBytes; }
+        // フレーム構造を持たないため索引・範囲デコードは非対応
+        bool BuildFrameIndex(const void*, size_t, FrameIndex&) const override { return false; }
+        std::vector<uint8_t> DecodeRange(const void*, size_t, const FrameIndex&, size_t, size_t) override { return {}; }
+        bool DecodeRangeInto(const void*, size_t, const FrameIndex&, size_t, size_t, std::span<uint8_t>, size_t& written) override {
+            written = 0;
+            return false;
+        }
+        DecodeStats GetDecodeStats() const override { return {}; }
+        void ReportLinkBudget(int) override {}
+        int GetBitrate() const override { return 0; }
+        CodecCapabilities GetCapabilities() const override;
+        void SetParallelism(int threads) override { m_parallelism = threads; }
         void GetFormat(int& sampleRate, int& channels, int& bitsPerSample) const override {
             sampleRate = m_sampleRate;
             channels = m_channels;
             bitsPerSample = m_bitsPerSample;
         }
+        AudioFormat GetAudioFormat() const override {
+            AudioFormat format = m_format;
+            format.sampleRate = m_sampleRate;
+            format.channels = m_channels;
+            return format;
+        }
+        bool Recycle() override;
         void Reset() override;
         std::string Name() const override { return "pcm"; }
 
@@ -26,5 +57,10 @@ namespace CodecTest
         int m_sampleRate{ 0 };
         int m_channels{ 0 };
         int m_bitsPerSample{ 0 };
+        AudioFormat m_format;
+        int m_parallelism{ 1 };
+
+        // 大きなバッファは共有ワーカープールで分割してコピーする
+        void Copy(uint8_t* dst, const void* src, size_t bytes) const;
     };
 }
@@ -0,0 +1,227 @@
+#include "../pch.h"
+#include "WorkerPool.h"
+#include <algorithm>
+#include <utility>
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+namespace CodecTest
+{
+    namespace {
+        // 実行中のスレッドがどのプールの何番目のワーカーか
+        thread_local WorkerPool* t_pool = nullptr;
+        thread_local size_t t_index = 0;
+
+        // 現在の共通プール。DLL のアンロード中にスレッドを join しないよう、この参照は意図的に解放しない。
+        // 作り直した古いプールは、最後の参照が外れた時点で解放される
+        std::shared_ptr<WorkerPool>* const g_shared = new std::shared_ptr<WorkerPool>();
+        std::mutex g_sharedMtx;
+        // 共通プールの設定（プールを作らずに読めるよう、プールとは別に保持する）
+        size_t g_sharedThreads = 0;
+        uint64_t g_sharedAffinity = 0;
+
+        // mask の立っているビットのうち n 番目（一巡したら先頭から）の CPU 番号
+        int NthCpu(uint64_t mask, size_t n)
+        {
+            int bits = 0;
+            for (int cpu = 0; cpu < 64; ++cpu) bits += (mask >> cpu) & 1;
+            n %= (size_t)bits;
+            for (int cpu = 0; cpu < 64; ++cpu) {
+                if (((mask >> cpu) & 1) && n-- == 0) return cpu;
+            }
+            return 0;
+        }
+
+        void PinThread(std::thread& t, int cpu)
+        {
+#ifdef _WIN32
+            SetThreadAffinityMask(t.native_handle(), (DWORD_PTR)1 << cpu);
+#else
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            pthread_setaffinity_np(t.native_handle(), sizeof(set), &set);
+#endif
+        }
+    }
+
+    WorkerPool::WorkerPool(size_t threads, uint64_t affinityMask)
+        : m_affinityMask(affinityMask)
+    {
+        if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+        m_threadCount = threads;
+        m_queues.reserve(threads);
+        for (size_t i = 0; i < threads; ++i) m_queues.push_back(std::make_unique<Queue>());
+        m_threads.reserve(threads);
+        for (size_t i = 0; i < threads; ++i) {
+            m_threads.emplace_back([this, i]() { WorkerLoop(i); });
+            // 固定に失敗しても動作には影響しない
+            if (affinityMask != 0) PinThread(m_threads.back(), NthCpu(affinityMask, i));
+        }
+    }
+
+    WorkerPool::~WorkerPool()
+    {
+        Stop();
+    }
+
+    std::shared_ptr<WorkerPool> WorkerPool::Shared()
+    {
+        std::lock_guard<std::mutex> lk(g_sharedMtx);
+        if (!*g_shared) *g_shared = std::make_shared<WorkerPool>(g_sharedThreads, g_sharedAffinity);
+        return *g_shared;
+    }
+
+    void WorkerPool::SharedConfig(size_t& threads, uint64_t& affinityMask) noexcept
+    {
+        std::lock_guard<std::mutex> lk(g_sharedMtx);
+        threads = g_sharedThreads;
+        affinityMask = g_sharedAffinity;
+    }
+
+    bool WorkerPool::ConfigureShared(size_t threads, uint64_t affinityMask) noexcept
+    {
+        if (t_pool) return false;
+        std::shared_ptr<WorkerPool> prev;
+        {
+            std::lock_guard<std::mutex> lk(g_sharedMtx);
+            g_sharedThreads = threads;
+            g_sharedAffinity = affinityMask;
+            // まだ作られていなければ設定だけ覚えておき、初回使用時にその設定で作る
+            if (*g_shared) prev = std::exchange(*g_shared, std::make_shared<WorkerPool>(threads, affinityMask));
+        }
+        // ワーカーはここで止まる（この後に古いプールへ投入されたタスクは呼び出し元で実行される）。
+        // 参照が残っていなければここで、残っていれば最後の参照が外れたときに解放される
+        if (prev) prev->Stop();
+        return true;
+    }
+
+    void WorkerPool::Submit(Task task)
+    {
+        m_submitted.fetch_add(1, std::memory_order_relaxed);
+        {
+            // 待機に入る直前のワーカーが通知を取りこぼさないよう、待機用のロック下で積む
+            std::unique_lock<std::mutex> lk(m_sleepMtx);
+            if (m_stop) {
+                lk.unlock();
+                Execute(task);
+                return;
+            }
+            // ワーカー上からは自分のキューへ、それ以外は順番に振り分ける
+            size_t index = (t_pool == this) ? t_index : m_nextQueue.fetch_add(1, std::memory_order_relaxed) % m_queues.size();
+            {
+                std::lock_guard<std::mutex> qlk(m_queues[index]->mtx);
+                m_queues[index]->tasks.push_back(std::move(task));
+            }
+            size_t pending = m_pending.fetch_add(1, std::memory_order_release) + 1;
+            size_t peak = m_peakPending.load(std::memory_order_relaxed);
+            while (pending > peak && !m_peakPending.compare_exchange_weak(peak, pending, std::memory_order_relaxed)) {}
+        }
+        m_wake.notify_one();
+    }
+
+    bool WorkerPool::RunOne()
+    {
+        Task task;
+        bool found = (t_pool == this) ? (TryPop(t_index, task) || TrySteal(t_index + 1, t_index, task)) : TrySteal(0, (size_t)-1, task);
+        if (!found) return false;
+        Execute(task);
+        return true;
+    }
+
+    void WorkerPool::Stop()
+    {
+        {
+            std::lock_guard<std::mutex> lk(m_sleepMtx);
+            if (m_stop) return;
+            m_stop = true;
+        }
+        m_wake.notify_all();
+        for (std::thread& t : m_threads) t.join();
+        m_threads.clear();
+    }
+
+    WorkerPoolStats WorkerPool::GetStats() const noexcept
+    {
+        WorkerPoolStats stats;
+        stats.threads = m_threadCount;
+        stats.submitted = m_submitted.load(std::memory_order_relaxed);
+        stats.executed = m_executed.load(std::memory_order_relaxed);
+        stats.steals = m_steals.load(std::memory_order_relaxed);
+        stats.queueDepth = m_pending.load(std::memory_order_relaxed);
+        stats.peakQueueDepth = m_peakPending.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    bool WorkerPool::TryPop(size_t index, Task& task)
+    {
+        Queue& q = *m_queues[index];
+        std::lock_guard<std::mutex> lk(q.mtx);
+        if (q.tasks.empty()) return false;
+        task = std::move(q.tasks.back());
+        q.tasks.pop_back();
+        m_pending.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    bool WorkerPool::TrySteal(size_t start, size_t skip, Task& task)
+    {
+        const size_t n = m_queues.size();
+        for (size_t k = 0; k < n; ++k) {
+            size_t index = (start + k) % n;
+            if (index == skip) continue;
+            Queue& q = *m_queues[index];
+            std::lock_guard<std::mutex> lk(q.mtx);
+            if (q.tasks.empty()) continue;
+            task = std::move(q.tasks.front());
+            q.tasks.pop_front();
+            m_pending.fetch_sub(1, std::memory_order_relaxed);
+            m_steals.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        return false;
+    }
+
+    void WorkerPool::Execute(Task& task)
+    {
+        task();
+        m_executed.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void WorkerPool::WorkerLoop(size_t index)
+    {
+        t_pool = this;
+        t_index = index;
+        for (;;) {
+            Task task;
+            if (TryPop(index, task) || TrySteal(index + 1, index, task)) {
+                Execute(task);
+                continue;
+            }
+            std::unique_lock<std::mutex> lk(m_sleepMtx);
+            m_wake.wait(lk, [this]() { return m_stop || m_pending.load(std::memory_order_acquire) > 0; });
+            // 停止時も残っているタスクは実行してから抜ける
+            if (m_stop && m_pending.load(std::memory_order_acquire) == 0) return;
+        }
+    }
+
+    void TaskGroup::Run(WorkerPool::Task task)
+    {
+        m_remaining.fetch_add(1, std::memory_order_relaxed);
+        m_pool->Submit([this, task = std::move(task)]() {
+            task();
+            // ロック下で減らす（Wait がロックを取れた時点でこのグループには触れていない）
+            std::lock_guard<std::mutex> lk(m_mtx);
+            if (m_remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) m_done.notify_all();
+        });
+    }
+
+    void TaskGroup::Wait()
+    {
+        // 残りがある間はプールのタスクを手伝い、取り出せるものが無くなったら完了を待つ
+        while (m_remaining.load(std::memory_order_acquire) > 0 && m_pool->RunOne()) {}
+        std::unique_lock<std::mutex> lk(m_mtx);
+        m_done.wait(lk, [this]() { return m_remaining.load(std::memory_order_acquire) == 0; });
+    }
+}
\ No newline at end of file
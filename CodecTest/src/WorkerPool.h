@@ -0,0 +1,110 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace CodecTest
+{
+    // プールの統計（調整用）
+    struct WorkerPoolStats
+    {
+        size_t threads{ 0 };
+        uint64_t submitted{ 0 };      // 投入されたタスク数
+        uint64_t executed{ 0 };       // 実行したタスク数（待機中のスレッドが手伝った分を含む）
+        uint64_t steals{ 0 };         // 他のワーカーのキューから取り出した回数
+        size_t queueDepth{ 0 };       // 現在キューに残っているタスク数
+        size_t peakQueueDepth{ 0 };   // キューに残っていたタスク数の最大値
+    };
+
+    // ワークスティーリング方式のスレッドプール。
+    // ワーカーごとにキューを持ち、自分のキューは後ろから（LIFO）、他のワーカーのキューは前から（FIFO）取り出す。
+    // ワーカー上で投入したタスクはそのワーカーのキューに積まれる。
+    class WorkerPool
+    {
+    public:
+        using Task = std::function<void()>;
+
+        // threads が 0 ならコア数。affinityMask が 0 以外なら、ワーカー i を立っているビットの i 番目（一巡したら先頭から）の CPU に固定する
+        explicit WorkerPool(size_t threads, uint64_t affinityMask = 0);
+        ~WorkerPool();
+        WorkerPool(const WorkerPool&) = delete;
+        WorkerPool& operator=(const WorkerPool&) = delete;
+
+        // ライブラリ共通のプール（初回使用時に作成。ConfigureShared の前ならコア数）。
+        // 並列処理（LdacCodec の区間分割、バッチ、非同期 API など）はすべてこれを使う。
+        // 作り直された後も、返された参照（TaskGroup が保持するものなど）がある間は古いプールは解放されない
+        static std::shared_ptr<WorkerPool> Shared();
+        // 共通のプールを作り直す。それまでのプールは残っているタスクを実行してから停止し、
+        // 最後の参照が外れた時点で解放される。まだ作られていなければ設定だけを記録する。
+        // ワーカー上（タスクの中）から呼ぶと false
+        static bool ConfigureShared(size_t threads, uint64_t affinityMask) noexcept;
+        // 共通プールの設定（ConfigureShared で指定した値。threads の 0 はコア数）。プールは作らない
+        static void SharedConfig(size_t& threads, uint64_t& affinityMask) noexcept;
+
+        // 停止後に投入されたタスクは呼び出し元スレッドでその場で実行する
+        void Submit(Task task);
+        // キューからタスクを 1 つ取り出して呼び出し元スレッドで実行する。無ければ false
+        bool RunOne();
+        // 残っているタスクを実行し終えてからワーカーを止める
+        void Stop();
+
+        size_t ThreadCount() const noexcept { return m_threadCount; }
+        uint64_t AffinityMask() const noexcept { return m_affinityMask; }
+        WorkerPoolStats GetStats() const noexcept;
+
+    private:
+        struct Queue
+        {
+            std::mutex mtx;
+            std::deque<Task> tasks;
+        };
+
+        void WorkerLoop(size_t index);
+        bool TryPop(size_t index, Task& task);
+        bool TrySteal(size_t start, size_t skip, Task& task);
+        void Execute(Task& task);
+
+        std::vector<std::unique_ptr<Queue>> m_queues;
+        std::vector<std::thread> m_threads;
+        size_t m_threadCount{ 0 };
+        uint64_t m_affinityMask{ 0 };
+        std::atomic<size_t> m_pending{ 0 };
+        std::atomic<size_t> m_nextQueue{ 0 };
+        std::mutex m_sleepMtx;
+        std::condition_variable m_wake;
+        bool m_stop{ false };
+
+        std::atomic<uint64_t> m_submitted{ 0 };
+        std::atomic<uint64_t> m_executed{ 0 };
+        std::atomic<uint64_t> m_steals{ 0 };
+        std::atomic<size_t> m_peakPending{ 0 };
+    };
+
+    // 投入したタスクの完了を待つためのグループ。
+    // Wait は待っている間もプールのタスクを実行するので、ワーカー上から呼んでも詰まらない。
+    class TaskGroup
+    {
+    public:
+        explicit TaskGroup(std::shared_ptr<WorkerPool> pool) noexcept : m_pool(std::move(pool)) {}
+        ~TaskGroup() { Wait(); }
+        TaskGroup(const TaskGroup&) = delete;
+        TaskGroup& operator=(const TaskGroup&) = delete;
+
+        void Run(WorkerPool::Task task);
+        void Wait();
+
+    private:
+        std::shared_ptr<WorkerPool> m_pool;  // 待ち終わるまでプールを生かしておく
+        std::atomic<size_t> m_remaining{ 0 };
+        std::mutex m_mtx;
+        std::condition_variable m_done;
+    };
+}
\ No newline at end of file
@@ -4,6 +4,20 @@
 #include <string>
 #include <cstring>
 #include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 #include "../CodecTest/CodecApi.h"
 
 #define DR_FLAC_IMPLEMENTATION
@@ -16,7 +30,9 @@ struct AudioData {
     uint32_t sampleRate = 0;
     uint32_t channels = 0;
     uint32_t bitsPerSample = 16;
-    std::vector<int16_t> pcmS16;
+    // Interleaved 16-bit PCM, not owned (the buffer Codec_Decode returned is written as is)
+    const uint8_t* pcm = nullptr;
+    size_t pcmBytes = 0;
 };
 
 // WAV Header
@@ -37,63 +53,373 @@ std::string GetExtension(const std::string& path) {
     return ext;
 }
 
-bool LoadWav(const std::string& path, AudioData& outAudio) {
-    std::ifstream inFile(path, std::ios::binary);
-    if (!inFile) return false;
+// Read-only mapping of a whole file. Pages come straight from the OS page cache on first
+// touch, so nothing is copied up front and repeated conversions of the same file hit the cache.
+class MappedFile {
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() { Close(); }
+
+    // Fails for missing and empty files
+    bool Open(const std::string& path) {
+        Close();
+#ifdef _WIN32
+        m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (m_file == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0) return false;
+        m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!m_mapping) return false;
+        void* view = MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!view) return false;
+        m_data = static_cast<const uint8_t*>(view);
+        m_size = (size_t)size.QuadPart;
+#else
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            close(fd);
+            return false;
+        }
+        void* view = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (view == MAP_FAILED) return false;
+        // Input is read front to back once: ask for aggressive read-ahead
+        madvise(view, (size_t)st.st_size, MADV_SEQUENTIAL);
+        m_data = static_cast<const uint8_t*>(view);
+        m_size = (size_t)st.st_size;
+#endif
+        return true;
+    }
+
+    void Close() {
+#ifdef _WIN32
+        if (m_data) UnmapViewOfFile(m_data);
+        if (m_mapping) CloseHandle(m_mapping);
+        if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+        m_mapping = nullptr;
+        m_file = INVALID_HANDLE_VALUE;
+#else
+        if (m_data) munmap(const_cast<uint8_t*>(m_data), m_size);
+#endif
+        m_data = nullptr;
+        m_size = 0;
+    }
+
+    const uint8_t* Data() const { return m_data; }
+    size_t Size() const { return m_size; }
+
+private:
+#ifdef _WIN32
+    HANDLE m_file = INVALID_HANDLE_VALUE;
+    HANDLE m_mapping = nullptr;
+#endif
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+};
 
-    WavHeader header;
-    inFile.read(reinterpret_cast<char*>(&header), sizeof(WavHeader));
+// PCM frames per streaming read (64 KB for 16-bit stereo)
+constexpr size_t kStreamBlockFrames = 16384;
+
+// Interleaved PCM pulled block by block, so only one block is held at a time
+class PcmSource {
+public:
+    virtual ~PcmSource() = default;
+    virtual uint32_t SampleRate() const = 0;
+    virtual uint32_t Channels() const = 0;
+    virtual uint32_t BitsPerSample() const = 0;
+    // CODEC_SAMPLE_* of the frames returned by Next
+    virtual int SampleFormat() const = 0;
+    uint32_t FrameBytes() const { return Channels() * BitsPerSample() / 8; }
+    // Next run of up to maxFrames frames, valid until the following call. Sets frames to the
+    // number available (0 at the end). May point into the source's own storage, so no copy is made.
+    virtual const uint8_t* Next(size_t maxFrames, size_t& frames) = 0;
+};
 
-    if (std::strncmp(header.riff, "RIFF", 4) != 0 || std::strncmp(header.wave, "WAVE", 4) != 0) return false;
-    if (header.formatType != 1) {
-        std::cerr << "Unsupported WAV format (PCM only)." << std::endl;
-        return false;
+// WAVE_FORMAT_* tags (for WAVE_FORMAT_EXTENSIBLE, the first two bytes of the SubFormat GUID)
+constexpr uint16_t kWaveFormatPcm = 0x0001;
+constexpr uint16_t kWaveFormatIeeeFloat = 0x0003;
+constexpr uint16_t kWaveFormatExtensible = 0xFFFE;
+
+// Streams the data chunk of a WAV file straight out of the file mapping. fmt and data are
+// located by walking the RIFF chunks, so LIST/fact/etc. in any order are skipped.
+// 16/24/32-bit integer and 32-bit float samples go to the codec at their native width.
+class WavSource : public PcmSource {
+public:
+    bool Open(const std::string& path) {
+        if (!m_file.Open(path) || m_file.Size() < 12) return false;
+        const uint8_t* file = m_file.Data();
+        const size_t fileSize = m_file.Size();
+        if (std::memcmp(file, "RIFF", 4) != 0 || std::memcmp(file + 8, "WAVE", 4) != 0) return false;
+
+        const uint8_t* fmt = nullptr;
+        uint32_t fmtSize = 0;
+        size_t pos = 12;
+        while (pos + 8 <= fileSize) {
+            const uint8_t* chunk = file + pos;
+            uint32_t size = ReadLE<uint32_t>(chunk + 4);
+            const uint8_t* body = chunk + 8;
+            uint64_t avail = fileSize - pos - 8;
+
+            if (std::memcmp(chunk, "fmt ", 4) == 0) {
+                if (size < 16 || size > avail) return false;
+                fmt = body;
+                fmtSize = size;
+            }
+            else if (std::memcmp(chunk, "data", 4) == 0) {
+                if (!fmt) {
+                    std::cerr << "WAV data chunk precedes fmt chunk." << std::endl;
+                    return false;
+                }
+                m_data = body;
+                // A truncated file (or a streaming writer's placeholder size) simply ends at EOF
+                m_remaining = std::min<uint64_t>(size, avail);
+                break;
+            }
+            // Chunks are padded to even sizes
+            pos += 8 + (uint64_t)size + (size & 1);
+        }
+        if (!fmt || !m_data) return false;
+
+        uint16_t formatTag = ReadLE<uint16_t>(fmt);
+        m_channels = ReadLE<uint16_t>(fmt + 2);
+        m_sampleRate = ReadLE<uint32_t>(fmt + 4);
+        uint16_t blockAlign = ReadLE<uint16_t>(fmt + 12);
+        m_bitsPerSample = ReadLE<uint16_t>(fmt + 14);
+        if (formatTag == kWaveFormatExtensible) {
+            // cbSize(2) validBits(2) channelMask(4) SubFormat(16)
+            if (fmtSize < 40) return false;
+            formatTag = ReadLE<uint16_t>(fmt + 24);
+        }
+        if (m_channels == 0 || blockAlign != m_channels * m_bitsPerSample / 8) return false;
+
+        // Integer samples narrower than their container are left-justified, so a 24-in-32
+        // file is fed as S32 as is
+        if (formatTag == kWaveFormatPcm && m_bitsPerSample == 16) m_sampleFormat = CODEC_SAMPLE_S16;
+        else if (formatTag == kWaveFormatPcm && m_bitsPerSample == 24) m_sampleFormat = CODEC_SAMPLE_S24;
+        else if (formatTag == kWaveFormatPcm && m_bitsPerSample == 32) m_sampleFormat = CODEC_SAMPLE_S32;
+        else if (formatTag == kWaveFormatIeeeFloat && m_bitsPerSample == 32) m_sampleFormat = CODEC_SAMPLE_F32;
+        else {
+            std::cerr << "Unsupported WAV format (tag 0x" << std::hex << formatTag << std::dec
+                      << ", " << m_bitsPerSample << "-bit)." << std::endl;
+            return false;
+        }
+        m_remaining -= m_remaining % FrameBytes();
+        return true;
+    }
+    uint32_t SampleRate() const override { return m_sampleRate; }
+    uint32_t Channels() const override { return m_channels; }
+    uint32_t BitsPerSample() const override { return m_bitsPerSample; }
+    int SampleFormat() const override { return m_sampleFormat; }
+    const uint8_t* Next(size_t maxFrames, size_t& frames) override {
+        frames = (size_t)std::min<uint64_t>(m_remaining / FrameBytes(), maxFrames);
+        const uint8_t* p = m_data;
+        m_data += frames * FrameBytes();
+        m_remaining -= frames * FrameBytes();
+        return p;
+    }
+private:
+    template <typename T>
+    static T ReadLE(const uint8_t* p) {
+        T v;
+        std::memcpy(&v, p, sizeof(T));
+        return v;
     }
 
-    outAudio.sampleRate = header.sampleRate;
-    outAudio.channels = header.channels;
-    outAudio.bitsPerSample = header.bitsPerSample;
+    MappedFile m_file;
+    uint32_t m_sampleRate = 0;
+    uint32_t m_channels = 0;
+    uint32_t m_bitsPerSample = 0;
+    int m_sampleFormat = CODEC_SAMPLE_S16;
+    const uint8_t* m_data = nullptr;
+    uint64_t m_remaining = 0;
+};
 
-    std::vector<char> rawData(header.dataSize);
-    inFile.read(rawData.data(), header.dataSize);
-    size_t bytesRead = inFile.gcount();
-    
-    if (header.bitsPerSample == 16) {
-        outAudio.pcmS16.resize(bytesRead / 2);
-        std::memcpy(outAudio.pcmS16.data(), rawData.data(), bytesRead);
-    } else {
-        std::cerr << "Only 16-bit WAV supported." << std::endl;
-        return false;
+// Decodes a FLAC file one block at a time as the encoder asks for it, so memory stays at
+// a couple of blocks however long the file is. Up to 16-bit streams are read as S16; deeper
+// ones as left-justified S32, keeping their full precision.
+class FlacSource : public PcmSource {
+public:
+    FlacSource() = default;
+    FlacSource(const FlacSource&) = delete;
+    FlacSource& operator=(const FlacSource&) = delete;
+    ~FlacSource() { if (m_flac) drflac_close(m_flac); }
+
+    bool Open(const std::string& path) {
+        m_flac = drflac_open_file(path.c_str(), NULL);
+        if (!m_flac || m_flac->channels == 0) return false;
+        m_block.resize(kStreamBlockFrames * FrameBytes());
+        return true;
     }
-    return true;
-}
+    uint32_t SampleRate() const override { return m_flac->sampleRate; }
+    uint32_t Channels() const override { return m_flac->channels; }
+    uint32_t BitsPerSample() const override { return m_flac->bitsPerSample <= 16 ? 16 : 32; }
+    int SampleFormat() const override { return m_flac->bitsPerSample <= 16 ? CODEC_SAMPLE_S16 : CODEC_SAMPLE_S32; }
+    const uint8_t* Next(size_t maxFrames, size_t& frames) override {
+        maxFrames = std::min(maxFrames, kStreamBlockFrames);
+        if (SampleFormat() == CODEC_SAMPLE_S16) {
+            frames = (size_t)drflac_read_pcm_frames_s16(m_flac, maxFrames, reinterpret_cast<drflac_int16*>(m_block.data()));
+        } else {
+            frames = (size_t)drflac_read_pcm_frames_s32(m_flac, maxFrames, reinterpret_cast<drflac_int32*>(m_block.data()));
+        }
+        return m_block.data();
+    }
+private:
+    drflac* m_flac = nullptr;
+    std::vector<uint8_t> m_block;
+};
 
-bool LoadFlac(const std::string& path, AudioData& outAudio) {
-    unsigned int channels, sampleRate;
-    drflac_uint64 totalFrames;
-    drflac_int16* data = drflac_open_file_and_read_pcm_frames_s16(path.c_str(), &channels, &sampleRate, &totalFrames, NULL);
-    if (!data) return false;
-
-    outAudio.channels = channels;
-    outAudio.sampleRate = sampleRate;
-    outAudio.bitsPerSample = 16;
-    outAudio.pcmS16.assign(data, data + totalFrames * channels);
-    drflac_free(data, NULL);
-    return true;
-}
+// Decodes an MP3 file incrementally, one block per request, so the first LDAC frames are
+// written long before the end of the file has been decoded.
+class Mp3Source : public PcmSource {
+public:
+    Mp3Source() = default;
+    Mp3Source(const Mp3Source&) = delete;
+    Mp3Source& operator=(const Mp3Source&) = delete;
+    ~Mp3Source() { if (m_open) drmp3_uninit(&m_mp3); }
+
+    bool Open(const std::string& path) {
+        if (!drmp3_init_file(&m_mp3, path.c_str(), NULL)) return false;
+        m_open = true;
+        if (m_mp3.channels == 0) return false;
+        m_block.resize(kStreamBlockFrames * m_mp3.channels);
+        return true;
+    }
+    uint32_t SampleRate() const override { return m_mp3.sampleRate; }
+    uint32_t Channels() const override { return m_mp3.channels; }
+    uint32_t BitsPerSample() const override { return 16; }
+    int SampleFormat() const override { return CODEC_SAMPLE_S16; }
+    const uint8_t* Next(size_t maxFrames, size_t& frames) override {
+        frames = (size_t)drmp3_read_pcm_frames_s16(&m_mp3, std::min(maxFrames, kStreamBlockFrames), m_block.data());
+        return reinterpret_cast<const uint8_t*>(m_block.data());
+    }
+private:
+    drmp3 m_mp3 = {};
+    bool m_open = false;
+    std::vector<drmp3_int16> m_block;
+};
 
-bool LoadMp3(const std::string& path, AudioData& outAudio) {
-    drmp3_config config;
-    drflac_uint64 totalFrames;
-    drmp3_int16* data = drmp3_open_file_and_read_pcm_frames_s16(path.c_str(), &config, &totalFrames, NULL);
-    if (!data) return false;
-
-    outAudio.channels = config.channels;
-    outAudio.sampleRate = config.sampleRate;
-    outAudio.bitsPerSample = 16;
-    outAudio.pcmS16.assign(data, data + totalFrames * config.channels);
-    drmp3_free(data, NULL);
-    return true;
+// Runs a decoding source (FLAC / MP3) on its own thread so decoding overlaps encoding: while the
+// encoder works on one block, the next is decoded into the other half of a double buffer.
+class PrefetchSource : public PcmSource {
+public:
+    explicit PrefetchSource(std::unique_ptr<PcmSource> inner)
+        : m_inner(std::move(inner)),
+          // Taken before the decoder thread starts touching the inner source
+          m_sampleRate(m_inner->SampleRate()), m_channels(m_inner->Channels()),
+          m_bitsPerSample(m_inner->BitsPerSample()), m_sampleFormat(m_inner->SampleFormat()) {
+        for (std::vector<uint8_t>& slot : m_slots) slot.resize(kStreamBlockFrames * FrameBytes());
+        m_thread = std::thread([this]() { Produce(); });
+    }
+    PrefetchSource(const PrefetchSource&) = delete;
+    PrefetchSource& operator=(const PrefetchSource&) = delete;
+    ~PrefetchSource() {
+        {
+            std::lock_guard<std::mutex> lk(m_mtx);
+            m_stop = true;
+        }
+        m_cv.notify_all();
+        m_thread.join();
+    }
+
+    uint32_t SampleRate() const override { return m_sampleRate; }
+    uint32_t Channels() const override { return m_channels; }
+    uint32_t BitsPerSample() const override { return m_bitsPerSample; }
+    int SampleFormat() const override { return m_sampleFormat; }
+    const uint8_t* Next(size_t maxFrames, size_t& frames) override {
+        std::unique_lock<std::mutex> lk(m_mtx);
+        // The block handed out last time is finished with once the caller comes back for more
+        if (m_holding && m_pos == m_frames[m_consume]) {
+            m_filled[m_consume] = false;
+            m_consume ^= 1;
+            m_pos = 0;
+            m_holding = false;
+            m_cv.notify_all();
+        }
+        if (!m_holding) {
+            m_cv.wait(lk, [this]() { return m_filled[m_consume] || m_done; });
+            if (!m_filled[m_consume]) {
+                frames = 0;
+                return nullptr;
+            }
+            m_holding = true;
+        }
+        frames = std::min(maxFrames, m_frames[m_consume] - m_pos);
+        const uint8_t* p = m_slots[m_consume].data() + m_pos * FrameBytes();
+        m_pos += frames;
+        return p;
+    }
+
+private:
+    void Produce() {
+        size_t slot = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lk(m_mtx);
+                m_cv.wait(lk, [&]() { return !m_filled[slot] || m_stop; });
+                if (m_stop) return;
+            }
+            // The slot is the producer's until it is marked filled
+            size_t frames = 0;
+            const uint8_t* pcm = m_inner->Next(kStreamBlockFrames, frames);
+            if (frames > 0) std::memcpy(m_slots[slot].data(), pcm, frames * FrameBytes());
+            {
+                std::lock_guard<std::mutex> lk(m_mtx);
+                if (frames == 0) m_done = true;
+                else {
+                    m_frames[slot] = frames;
+                    m_filled[slot] = true;
+                }
+            }
+            m_cv.notify_all();
+            if (frames == 0) return;
+            slot ^= 1;
+        }
+    }
+
+    std::unique_ptr<PcmSource> m_inner;
+    uint32_t m_sampleRate;
+    uint32_t m_channels;
+    uint32_t m_bitsPerSample;
+    int m_sampleFormat;
+    std::vector<uint8_t> m_slots[2];
+    size_t m_frames[2] = {};
+    bool m_filled[2] = {};
+    size_t m_consume = 0;     // slot the encoder reads from
+    size_t m_pos = 0;         // frames of it already handed out
+    bool m_holding = false;
+    bool m_done = false;
+    bool m_stop = false;
+    std::mutex m_mtx;
+    std::condition_variable m_cv;
+    std::thread m_thread;
+};
+
+// Feeds the source through the codec's streaming session block by block, writing
+// each chunk of LDAC as it comes out. Memory stays at one PCM and one output block.
+bool EncodeToFile(void* codec, PcmSource& source, const std::string& path) {
+    std::ofstream ofs(path, std::ios::binary);
+    if (!ofs) return false;
+
+    std::vector<uint8_t> out(Codec_GetMaxEncodedSize(codec, kStreamBlockFrames * source.FrameBytes()));
+    if (out.empty()) return false;
+
+    size_t written = 0;
+    size_t total = 0;
+    size_t frames = 0;
+    const uint8_t* pcm;
+    while ((pcm = source.Next(kStreamBlockFrames, frames)), frames > 0) {
+        if (!Codec_EncodeStreamInto(codec, pcm, frames * source.FrameBytes(), out.data(), out.size(), &written)) return false;
+        ofs.write(reinterpret_cast<const char*>(out.data()), written);
+        total += written;
+    }
+    if (!Codec_FlushStreamInto(codec, out.data(), out.size(), &written)) return false;
+    ofs.write(reinterpret_cast<const char*>(out.data()), written);
+    total += written;
+    return ofs.good() && total > 0;
 }
 
 bool WriteWav(const std::string& path, const AudioData& audio) {
@@ -113,28 +439,34 @@ bool WriteWav(const std::string& path, const AudioData& audio) {
     h.byteRate = h.sampleRate * h.blockAlign;
     std::memcpy(h.dataChunkHeader, "data", 4);
     
-    size_t dataSize = audio.pcmS16.size() * sizeof(int16_t);
+    size_t dataSize = audio.pcmBytes;
     h.dataSize = (uint32_t)dataSize;
     h.overallSize = h.dataSize + sizeof(WavHeader) - 8;
 
     outFile.write(reinterpret_cast<char*>(&h), sizeof(WavHeader));
-    outFile.write(reinterpret_cast<const char*>(audio.pcmS16.data()), dataSize);
-    return true;
+    outFile.write(reinterpret_cast<const char*>(audio.pcm), dataSize);
+    return outFile.good();
 }
 
 int main(int argc, char* argv[])
 {
     std::string inFile, outFile;
+    int threads = 1;
 
     for (int i = 1; i < argc; ++i) {
         std::string arg = argv[i];
         if (arg.rfind("if=", 0) == 0) inFile = arg.substr(3);
         else if (arg.rfind("of=", 0) == 0) outFile = arg.substr(3);
+        else if (arg.rfind("threads=", 0) == 0) threads = std::max(0, std::atoi(arg.substr(8).c_str()));
     }
 
     if (inFile.empty()) {
-        std::cout << "Usage: " << argv[0] << " if=<input_file> [of=<output_file>]" << std::endl;
+        std::cout << "Usage: " << argv[0] << " if=<input_file> [of=<output_file>] [threads=<n>]" << std::endl;
         std::cout << "  Auto-detects format based on extension." << std::endl;
+        std::cout << "  threads: worker threads for encode/decode (default 1, 0 = all cores)." << std::endl;
+        std::cout << "           LDAC input is split across them in one pass; encodes stay streamed block by" << std::endl;
+        std::cout << "           block and use them for the channel pairs of multichannel input. FLAC/MP3" << std::endl;
+        std::cout << "           input is always decoded on its own thread while the encoder streams it." << std::endl;
         std::cout << "  Supported Input:  .wav, .flac, .mp3, .ldac" << std::endl;
         std::cout << "  Supported Output: .ldac, .wav" << std::endl;
         return 0;
@@ -165,39 +497,49 @@ int main(int argc, char* argv[])
         return 1;
     }
 
+    // Split the file across the library's shared worker pool
+    if (threads != 1) {
+        Codec_SetThreadCount(threads);
+        Codec_SetParallelism(codec, 0);
+    }
+
     if (isEncoding) {
         // ENCODE (WAV/FLAC/MP3 -> LDAC)
-        AudioData audio;
-        bool loaded = false;
-        if (inExt == "wav") loaded = LoadWav(inFile, audio);
-        else if (inExt == "flac") loaded = LoadFlac(inFile, audio);
-        else if (inExt == "mp3") loaded = LoadMp3(inFile, audio);
+        std::unique_ptr<PcmSource> source;
+        if (inExt == "wav") {
+            auto wav = std::make_unique<WavSource>();
+            if (wav->Open(inFile)) source = std::move(wav);
+        }
+        else if (inExt == "flac") {
+            auto flac = std::make_unique<FlacSource>();
+            if (flac->Open(inFile)) source = std::make_unique<PrefetchSource>(std::move(flac));
+        }
+        else if (inExt == "mp3") {
+            auto mp3 = std::make_unique<Mp3Source>();
+            if (mp3->Open(inFile)) source = std::make_unique<PrefetchSource>(std::move(mp3));
+        }
         else {
              std::cerr << "Unsupported input format: " << inExt << std::endl;
              return 1;
         }
 
-        if (!loaded) {
+        if (!source) {
             std::cerr << "Failed to load input file." << std::endl;
             return 1;
         }
         
         std::cout << "Encoding " << inFile << " -> " << outFile << " ..." << std::endl;
-        std::cout << "  Source: " << audio.sampleRate << "Hz, " << audio.channels << "ch" << std::endl;
+        std::cout << "  Source: " << source->SampleRate() << "Hz, " << source->Channels() << "ch, "
+                  << source->BitsPerSample() << "bit" << (source->SampleFormat() == CODEC_SAMPLE_F32 ? " float" : "") << std::endl;
 
-        if (!Codec_Initialize(codec, audio.sampleRate, audio.channels, audio.bitsPerSample)) {
+        if (!Codec_InitializeFormat(codec, source->SampleRate(), source->Channels(), source->SampleFormat())) {
             std::cerr << "Codec initialization failed." << std::endl;
             return 1;
         }
 
-        size_t pcmBytes = audio.pcmS16.size() * sizeof(int16_t);
-        size_t outSize = 0;
-        uint8_t* encodedData = Codec_Encode(codec, audio.pcmS16.data(), pcmBytes, &outSize);
-
-        if (encodedData && outSize > 0) {
-            std::ofstream ofs(outFile, std::ios::binary);
-            ofs.write(reinterpret_cast<char*>(encodedData), outSize);
-            Codec_FreeBuffer(encodedData);
+        // Always streamed, so memory stays bounded whatever the file size. A one-shot encode
+        // split across the pool would need an output buffer for the whole file.
+        if (EncodeToFile(codec, *source, outFile)) {
             std::cout << "Done." << std::endl;
         } else {
             std::cerr << "Encoding failed (no output)." << std::endl;
@@ -205,22 +547,17 @@ int main(int argc, char* argv[])
 
     } else {
         // DECODE (LDAC -> WAV)
-        std::ifstream ifs(inFile, std::ios::binary);
-        if (!ifs) {
-            std::cerr << "Failed to open input file." << std::endl;
-            return 1;
-        }
-        
-        std::vector<char> ldacData((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
-        if (ldacData.empty()) {
-            std::cerr << "Input file is empty." << std::endl;
+        // The mapped file goes to the decoder as is, without reading it into a buffer first
+        MappedFile ldacData;
+        if (!ldacData.Open(inFile)) {
+            std::cerr << "Failed to open input file (missing or empty)." << std::endl;
             return 1;
         }
 
         std::cout << "Decoding " << inFile << " -> " << outFile << " ..." << std::endl;
 
         size_t decodedSize = 0;
-        uint8_t* decodedPcm = Codec_Decode(codec, ldacData.data(), ldacData.size(), &decodedSize);
+        uint8_t* decodedPcm = Codec_Decode(codec, ldacData.Data(), ldacData.Size(), &decodedSize);
         
         if (decodedPcm && decodedSize > 0) {
             AudioData outAudio;
@@ -237,13 +574,13 @@ int main(int argc, char* argv[])
                 outAudio.bitsPerSample = 16;
                 std::cerr << "Warning: Could not retrieve decoded format. Defaulting to 48kHz/2ch." << std::endl;
             }
-            
-            outAudio.pcmS16.resize(decodedSize / 2);
-            std::memcpy(outAudio.pcmS16.data(), decodedPcm, decodedSize);
-            
-            WriteWav(outFile, outAudio);
+
+            outAudio.pcm = decodedPcm;
+            outAudio.pcmBytes = decodedSize;
+            bool saved = WriteWav(outFile, outAudio);
             Codec_FreeBuffer(decodedPcm);
-            std::cout << "Done." << std::endl;
+            if (saved) std::cout << "Done." << std::endl;
+            else std::cerr << "Failed to write " << outFile << "." << std::endl;
         } else {
             std::cerr << "Decoding failed." << std::endl;
         }
@@ -0,0 +1,335 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <deque>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+#include <random>
+#include <algorithm>
+#include "../CodecTest/CodecApi.h"
+
+// Offline Bluetooth link simulator for tuning the LDAC adaptive bitrate controller.
+// Feeds a synthetic real-time source through Codec_EncodeStream, packs the frames into
+// MTU-sized transport packets, pushes them through a token-bucket link driven by a
+// throughput/loss trace, and reports what the receiver would have seen. Uses only the
+// C API and the standard library.
+
+// One trace step: from timeMs on, the link carries kbps with lossPercent packet loss
+struct TracePoint {
+    double timeMs = 0;
+    double kbps = 0;
+    double lossPercent = 0;
+};
+
+struct SimConfig {
+    std::string tracePath;
+    std::string csvPath;
+    int sampleRate = 48000;
+    int quality = CODEC_QUALITY_HIGH;
+    int mtu = 0;
+    bool adaptive = true;
+    double durationMs = 0;        // 0: until the end of the trace
+    double jitterBufferMs = 100;  // receiver playout delay after each frame's capture
+    double propagationMs = 5;
+    double reportMs = 100;        // link budget report interval
+    double burstBytes = 0;        // token bucket depth; 0: two packets (never less than one packet)
+    uint32_t seed = 1;
+    long maxUnderruns = -1;       // >= 0: exit code 2 when exceeded (for regression runs)
+};
+
+// Frame in flight, from capture to playout
+struct SimFrame {
+    uint64_t index = 0;
+    double capturedMs = 0;    // when the frame's first sample was captured
+    double generatedMs = 0;   // when the encoder released it
+    double deliveredMs = -1;
+    uint32_t bytes = 0;
+    int kbps = 0;
+    bool lost = false;
+};
+
+// Transport packet: consecutive frames up to the MTU, delivered or lost together
+struct SimPacket {
+    size_t firstFrame = 0;
+    size_t frameCount = 0;
+    uint32_t bytes = 0;
+};
+
+// Trace file: one "<time_ms> <throughput_kbps> [loss_percent]" per line (loss applies per packet), '#' starts a comment.
+// Each line holds until the next one; the last line holds until the end of the run.
+bool LoadTrace(const std::string& path, std::vector<TracePoint>& trace) {
+    std::ifstream in(path);
+    if (!in) return false;
+
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t hash = line.find('#');
+        if (hash != std::string::npos) line.resize(hash);
+        std::istringstream ss(line);
+        TracePoint p;
+        if (!(ss >> p.timeMs >> p.kbps)) continue;
+        ss >> p.lossPercent;
+        trace.push_back(p);
+    }
+    std::sort(trace.begin(), trace.end(), [](const TracePoint& a, const TracePoint& b) { return a.timeMs < b.timeMs; });
+    return !trace.empty();
+}
+
+const TracePoint& TraceAt(const std::vector<TracePoint>& trace, double timeMs, size_t& cursor) {
+    while (cursor + 1 < trace.size() && trace[cursor + 1].timeMs <= timeMs) cursor++;
+    return trace[cursor];
+}
+
+// Splits encoder output into LDAC frames (3-byte header: sync 0xAA, then the 9-bit frame length - 1)
+void SplitFrames(const uint8_t* data, size_t size, std::vector<uint32_t>& frameBytes) {
+    size_t pos = 0;
+    while (pos + 3 <= size) {
+        if (data[pos] != 0xAA) { pos++; continue; }
+        uint32_t length = ((((uint32_t)data[pos + 1] & 0x07) << 6) | (data[pos + 2] >> 2)) + 1;
+        uint32_t bytes = 3 + length;
+        if (pos + bytes > size) break;
+        frameBytes.push_back(bytes);
+        pos += bytes;
+    }
+}
+
+double Percentile(std::vector<double> values, double p) {
+    if (values.empty()) return 0;
+    std::sort(values.begin(), values.end());
+    size_t i = (size_t)std::min<double>((double)values.size() - 1, std::floor(p / 100.0 * values.size()));
+    return values[i];
+}
+
+int RunSimulation(const SimConfig& cfg, const std::vector<TracePoint>& trace) {
+    void* codec = Codec_Create("ldac");
+    if (!codec) {
+        std::cerr << "Failed to create codec." << std::endl;
+        return 1;
+    }
+
+    Codec_AudioFormat format = { cfg.sampleRate, 2, CODEC_SAMPLE_S16, 1 };
+    Codec_EncoderOptions options = { cfg.quality, cfg.mtu, cfg.adaptive ? 1 : 0 };
+    if (!Codec_InitializeEx(codec, &format, &options)) {
+        std::cerr << "Codec initialization failed." << std::endl;
+        Codec_Destroy(codec);
+        return 1;
+    }
+
+    // The packet size and frame period the codec settled on (cfg.mtu 0 picks its default)
+    Codec_Capabilities caps = {};
+    Codec_GetCapabilities(codec, &caps);
+    const double durationMs = cfg.durationMs > 0 ? cfg.durationMs : std::max(trace.back().timeMs, 1000.0);
+    const uint32_t mtu = (uint32_t)std::max(caps.mtu, 1);
+    const double frameMs = caps.frameSamples * 1000.0 / cfg.sampleRate;
+
+    // A packet the bucket can never hold would stall the link for good, so the bucket holds
+    // at least one full packet (or one frame, if a frame does not fit the MTU)
+    const double minBurst = (double)std::max<size_t>(mtu, caps.maxFrameBytes);
+    double burstBytes = cfg.burstBytes > 0 ? cfg.burstBytes : 2.0 * mtu;
+    if (burstBytes < minBurst) {
+        std::cerr << "Warning: burst=" << burstBytes << " is smaller than one packet; using " << minBurst << std::endl;
+        burstBytes = minBurst;
+    }
+
+    // 1 ms simulation tick; the source delivers 1 ms of PCM per tick (carried remainders
+    // are handled by the streaming encoder)
+    const double tickMs = 1.0;
+    std::mt19937 rng(cfg.seed);
+    std::uniform_real_distribution<double> uniform(0.0, 100.0);
+
+    std::vector<int16_t> pcm;
+    double phase = 0;
+    double samplesDue = 0;
+    uint64_t samplesFed = 0;
+
+    std::vector<SimFrame> frames;
+    std::deque<SimPacket> sendQueue;
+    std::vector<uint32_t> split;
+    double tokens = burstBytes;
+    size_t traceCursor = 0;
+    double nextReportMs = 0;
+    int lastKbps = Codec_GetBitrate(codec);
+    int qualityChanges = 0;
+    uint64_t packets = 0, lostPackets = 0;
+
+    for (double now = 0; now < durationMs; now += tickMs) {
+        const TracePoint& link = TraceAt(trace, now, traceCursor);
+
+        // Radio reports its current budget; the controller decides on quality
+        if (now >= nextReportMs) {
+            Codec_ReportLinkBudget(codec, (int)std::max(1.0, link.kbps * (1.0 - link.lossPercent / 100.0)));
+            nextReportMs += cfg.reportMs;
+        }
+        int kbps = Codec_GetBitrate(codec);
+        if (kbps != lastKbps) {
+            qualityChanges++;
+            lastKbps = kbps;
+        }
+
+        // Capture: a tone sweep, so the encoder sees non-trivial content
+        samplesDue += cfg.sampleRate * tickMs / 1000.0;
+        size_t count = (size_t)samplesDue - (size_t)samplesFed;
+        pcm.resize(count * 2);
+        for (size_t i = 0; i < count; ++i) {
+            double t = (double)(samplesFed + i) / cfg.sampleRate;
+            phase += 2.0 * 3.14159265358979 * (220.0 + 40.0 * t) / cfg.sampleRate;
+            int16_t v = (int16_t)(std::sin(phase) * 12000.0);
+            pcm[2 * i] = v;
+            pcm[2 * i + 1] = (int16_t)(v / 2);
+        }
+        samplesFed += count;
+
+        size_t outSize = 0;
+        uint8_t* coded = count > 0 ? Codec_EncodeStream(codec, pcm.data(), pcm.size() * sizeof(int16_t), &outSize) : nullptr;
+        if (coded) {
+            split.clear();
+            SplitFrames(coded, outSize, split);
+            // ldacBT releases a packet's worth of frames at a time: pack what came out of this
+            // call into packets of up to the MTU
+            SimPacket packet;
+            for (uint32_t bytes : split) {
+                if (packet.frameCount > 0 && packet.bytes + bytes > mtu) {
+                    sendQueue.push_back(packet);
+                    packet = SimPacket();
+                }
+                if (packet.frameCount == 0) packet.firstFrame = frames.size();
+                packet.frameCount++;
+                packet.bytes += bytes;
+
+                SimFrame f;
+                f.index = frames.size();
+                f.capturedMs = f.index * frameMs;
+                f.generatedMs = now + tickMs;
+                f.bytes = bytes;
+                f.kbps = kbps;
+                frames.push_back(f);
+            }
+            if (packet.frameCount > 0) sendQueue.push_back(packet);
+            Codec_FreeBuffer(coded);
+        }
+
+        // Token bucket: refill at the trace throughput, send whole packets in order; a lost
+        // packet takes every frame in it
+        tokens = std::min(burstBytes, tokens + link.kbps * 1000.0 / 8.0 * tickMs / 1000.0);
+        while (!sendQueue.empty() && tokens >= sendQueue.front().bytes) {
+            const SimPacket& packet = sendQueue.front();
+            tokens -= packet.bytes;
+            const bool lost = uniform(rng) < link.lossPercent;
+            for (size_t i = packet.firstFrame; i < packet.firstFrame + packet.frameCount; ++i) {
+                if (lost) frames[i].lost = true;
+                else frames[i].deliveredMs = now + tickMs + cfg.propagationMs;
+            }
+            packets++;
+            if (lost) lostPackets++;
+            sendQueue.pop_front();
+        }
+    }
+
+    // Receiver: each frame plays jitterBufferMs after it was captured, so the encoder's own
+    // delay counts against the buffer. A frame that is lost, still queued, or arrives after
+    // its slot is an underrun.
+    std::ofstream csv;
+    if (!cfg.csvPath.empty()) {
+        csv.open(cfg.csvPath);
+        csv << "frame,captured_ms,generated_ms,delivered_ms,latency_ms,bytes,kbps,status\n";
+    }
+
+    uint64_t delivered = 0, lost = 0, late = 0, pending = 0;
+    uint64_t deliveredBytes = 0;
+    std::vector<double> latencies;
+    latencies.reserve(frames.size());
+    for (const SimFrame& f : frames) {
+        double deadline = f.capturedMs + cfg.jitterBufferMs;
+        const char* status = "ok";
+        if (f.lost) {
+            lost++;
+            status = "lost";
+        } else if (f.deliveredMs < 0) {
+            pending++;
+            status = "queued";
+        } else {
+            delivered++;
+            deliveredBytes += f.bytes;
+            latencies.push_back(f.deliveredMs - f.capturedMs);
+            if (f.deliveredMs > deadline) {
+                late++;
+                status = "late";
+            }
+        }
+        if (csv) {
+            csv << f.index << ',' << f.capturedMs << ',' << f.generatedMs << ',' << f.deliveredMs << ','
+                << (f.deliveredMs >= 0 ? f.deliveredMs - f.capturedMs : -1) << ','
+                << f.bytes << ',' << f.kbps << ',' << status << '\n';
+        }
+    }
+
+    double meanLatency = 0;
+    for (double l : latencies) meanLatency += l;
+    if (!latencies.empty()) meanLatency /= latencies.size();
+    const uint64_t underruns = lost + late + pending;
+
+    std::cout << "Simulated " << durationMs / 1000.0 << " s, " << frames.size() << " frames ("
+              << cfg.sampleRate << " Hz, " << (cfg.adaptive ? "adaptive" : "fixed") << ")" << std::endl;
+    std::cout << "  Delivered bitrate: " << (deliveredBytes * 8.0 / durationMs) << " kbps" << std::endl;
+    std::cout << "  Delivered: " << delivered << "  Lost: " << lost << "  Late: " << late << "  Still queued: " << pending << std::endl;
+    std::cout << "  Packets sent: " << packets << "  lost: " << lostPackets << " (MTU " << mtu << " bytes)" << std::endl;
+    std::cout << "  Underruns: " << underruns << std::endl;
+    std::cout << "  Latency ms (from capture): mean " << meanLatency << "  p95 " << Percentile(latencies, 95)
+              << "  max " << Percentile(latencies, 100) << std::endl;
+    std::cout << "  Quality changes: " << qualityChanges << "  Final bitrate: " << lastKbps << " kbps" << std::endl;
+
+    Codec_Destroy(codec);
+
+    if (cfg.maxUnderruns >= 0 && underruns > (uint64_t)cfg.maxUnderruns) {
+        std::cerr << "Underruns exceed max-underruns=" << cfg.maxUnderruns << std::endl;
+        return 2;
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    SimConfig cfg;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        size_t eq = arg.find('=');
+        if (eq == std::string::npos) continue;
+        std::string key = arg.substr(0, eq);
+        std::string value = arg.substr(eq + 1);
+        if (key == "trace") cfg.tracePath = value;
+        else if (key == "csv") cfg.csvPath = value;
+        else if (key == "rate") cfg.sampleRate = std::stoi(value);
+        else if (key == "quality") cfg.quality = value == "mq" ? CODEC_QUALITY_MOBILE : value == "sq" ? CODEC_QUALITY_STANDARD : CODEC_QUALITY_HIGH;
+        else if (key == "mtu") cfg.mtu = std::stoi(value);
+        else if (key == "adaptive") cfg.adaptive = value != "0";
+        else if (key == "dur") cfg.durationMs = std::stod(value) * 1000.0;
+        else if (key == "jb") cfg.jitterBufferMs = std::stod(value);
+        else if (key == "delay") cfg.propagationMs = std::stod(value);
+        else if (key == "report") cfg.reportMs = std::max(1.0, std::stod(value));
+        else if (key == "burst") cfg.burstBytes = std::stod(value);
+        else if (key == "seed") cfg.seed = (uint32_t)std::stoul(value);
+        else if (key == "max-underruns") cfg.maxUnderruns = std::stol(value);
+    }
+
+    if (cfg.tracePath.empty()) {
+        std::cout << "Usage: " << argv[0] << " trace=<trace_file> [options]" << std::endl;
+        std::cout << "  Trace lines: <time_ms> <throughput_kbps> [loss_percent]   (loss per transport packet)" << std::endl;
+        std::cout << "  rate=<Hz> quality=hq|sq|mq mtu=<bytes> adaptive=0|1 dur=<s>" << std::endl;
+        std::cout << "  jb=<ms> delay=<ms> report=<ms> burst=<bytes> seed=<n>" << std::endl;
+        std::cout << "  csv=<file>          per-frame log" << std::endl;
+        std::cout << "  max-underruns=<n>   exit with 2 when exceeded" << std::endl;
+        return 0;
+    }
+
+    std::vector<TracePoint> trace;
+    if (!LoadTrace(cfg.tracePath, trace)) {
+        std::cerr << "Failed to load trace: " << cfg.tracePath << std::endl;
+        return 1;
+    }
+
+    return RunSimulation(cfg, trace);
+}